@@ -0,0 +1,178 @@
+#include "actuatorTiming.h"
+#include <Preferences.h>
+#include "drive.h"
+
+const uint8_t ACTUATOR_TIMING_VERSION = 2;
+const char* const ACTUATOR_NAMESPACE = "actuator";
+const char* const ACTUATOR_KEY = "timing";
+
+// Roughly the old fixed RETURN_DELAY for a full 60 degree swing
+const ActuatorTiming DEFAULT_TIMING = {ACTUATOR_TIMING_VERSION, 20, 8.0, 300};
+
+// Steering angles stepped through from centre, small and large swings both ways.
+// The step size is taken from the angle actually set.
+const int SERVO_STEP_ANGLES[] = {CENTER_ANGLE + 10, CENTER_ANGLE, RIGHT_ANGLE, LEFT_ANGLE, CENTER_ANGLE};
+const int SERVO_STEP_COUNT = sizeof(SERVO_STEP_ANGLES) / sizeof(SERVO_STEP_ANGLES[0]);
+
+ActuatorTiming timing = DEFAULT_TIMING;
+bool timingMeasured = false;
+
+void setupActuatorTiming() {
+  Preferences prefs;
+  prefs.begin(ACTUATOR_NAMESPACE, true);
+  ActuatorTiming stored;
+  size_t length = prefs.getBytes(ACTUATOR_KEY, &stored, sizeof(stored));
+  prefs.end();
+
+  if (length == sizeof(stored) && stored.version == ACTUATOR_TIMING_VERSION) {
+    timing = stored;
+    timingMeasured = true;
+  } else {
+    Serial.println("[Actuator] No characterization stored, using defaults. Run \"calibrate\"");
+  }
+}
+
+unsigned long servoSettleMs(int fromAngle, int toAngle) {
+  if (fromAngle == toAngle) {
+    return 0;
+  }
+  return timing.servoDeadMs + lroundf(timing.servoMsPerDegree * abs(toAngle - fromAngle));
+}
+
+unsigned long motorSpinUpMs() {
+  return timing.motorSpinUpMs;
+}
+
+unsigned long motorSpinDownMs() {
+  return MOTOR_SPIN_DOWN_MS;
+}
+
+// Time from now until the pin reads steady away from where it started, or -1
+// on timeout. Readings inside the start band don't count: right after the
+// command the actuator hasn't reacted yet, and would look settled at once.
+// The first sample of the steady run counts as the settle point.
+long measureSettleMs(int pin, int startReading) {
+  unsigned long start = millis();
+  int reading = analogRead(pin);
+  while (abs(reading - startReading) <= SETTLE_BAND_COUNTS) {
+    if (millis() - start >= SETTLE_TIMEOUT_MS) {
+      return -1;
+    }
+    delay(SETTLE_SAMPLE_MS);
+    reading = analogRead(pin);
+  }
+
+  unsigned long runStart = millis();
+  int low = reading;
+  int high = reading;
+  int samples = 1;
+  while (millis() - start < SETTLE_TIMEOUT_MS) {
+    delay(SETTLE_SAMPLE_MS);
+    reading = analogRead(pin);
+    low = min(low, reading);
+    high = max(high, reading);
+    if (high - low > SETTLE_BAND_COUNTS) {
+      runStart = millis();
+      low = reading;
+      high = reading;
+      samples = 1;
+      continue;
+    }
+    if (++samples >= SETTLE_SAMPLES) {
+      return runStart - start;
+    }
+  }
+  return -1;
+}
+
+// Least squares fit of settle time against step size
+bool characterizeServos(ActuatorTiming& result) {
+  float sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+  int count = 0;
+
+  setSteering(0);
+  delay(SETTLE_TIMEOUT_MS / 3);
+  for (int trial = 0; trial < CHARACTERIZE_TRIALS; trial++) {
+    for (int step = 0; step < SERVO_STEP_COUNT; step++) {
+      int from = steeringAngle();
+      int startReading = analogRead(SERVO_FEEDBACK_PIN);
+      setSteering(map(SERVO_STEP_ANGLES[step], LEFT_ANGLE, RIGHT_ANGLE, -MAX_CURVATURE, MAX_CURVATURE));
+      int to = steeringAngle();
+      long settle = measureSettleMs(SERVO_FEEDBACK_PIN, startReading);
+      if (settle < 0) {
+        Serial.printf("[Actuator] Servo did not move and settle stepping %d -> %d\n", from, to);
+        return false;
+      }
+      // Nothing moves inside one PWM frame, a shorter time is a misread
+      if (settle < MIN_SERVO_SETTLE_MS) {
+        Serial.printf("[Actuator] Servo settled in %ld ms stepping %d -> %d, too fast to be real\n", settle, from,
+                      to);
+        return false;
+      }
+      float degrees = abs(to - from);
+      sumX += degrees;
+      sumY += settle;
+      sumXX += degrees * degrees;
+      sumXY += degrees * settle;
+      count++;
+    }
+  }
+  centerWheels();
+
+  float slope = (count * sumXY - sumX * sumY) / (count * sumXX - sumX * sumX);
+  float intercept = (sumY - slope * sumX) / count;
+  if (slope <= 0) {
+    Serial.println("[Actuator] Bigger steering steps didn't take longer, feedback looks wrong");
+    return false;
+  }
+  result.servoMsPerDegree = slope;
+  result.servoDeadMs = max(intercept, 0.0f) + SETTLE_MARGIN_MS;
+  return true;
+}
+
+// Worst of the trials, the inrush current dies away as the motor reaches speed.
+// Each run up starts from rest.
+bool characterizeMotors(ActuatorTiming& result) {
+  long worstUp = 0;
+  for (int trial = 0; trial < CHARACTERIZE_TRIALS; trial++) {
+    int startReading = analogRead(MOTOR_SENSE_PIN);
+    setMotorSpeeds(MAX_SPEED, MAX_SPEED);
+    long up = measureSettleMs(MOTOR_SENSE_PIN, startReading);
+    stopMotors();
+    if (up < 0) {
+      Serial.println("[Actuator] Motor current did not rise and settle");
+      return false;
+    }
+    worstUp = max(worstUp, up);
+    delay(MOTOR_SPIN_DOWN_MS);
+  }
+  result.motorSpinUpMs = worstUp + SETTLE_MARGIN_MS;
+  return true;
+}
+
+bool characterizeActuators() {
+  Serial.println("[Actuator] Characterizing, keep the wheels off the ground...");
+  ActuatorTiming result = timing;
+  result.version = ACTUATOR_TIMING_VERSION;
+  if (!characterizeServos(result) || !characterizeMotors(result)) {
+    Serial.println("[Actuator] Characterization failed, timing unchanged");
+    return false;
+  }
+
+  timing = result;
+  timingMeasured = true;
+  Preferences prefs;
+  prefs.begin(ACTUATOR_NAMESPACE, false);
+  prefs.putBytes(ACTUATOR_KEY, &timing, sizeof(timing));
+  prefs.end();
+  printActuatorTiming();
+  return true;
+}
+
+void printActuatorTiming() {
+  Serial.printf("[Actuator] %s timing\n", timingMeasured ? "Measured" : "Default");
+  Serial.printf("[Actuator] Servo settle: %u ms + %.2f ms/deg (%lu ms for a full swing)\n", timing.servoDeadMs,
+                timing.servoMsPerDegree, servoSettleMs(LEFT_ANGLE, RIGHT_ANGLE));
+  Serial.printf("[Actuator] Motor spin up: %u ms, spin down: %lu ms (fixed)\n", timing.motorSpinUpMs,
+                MOTOR_SPIN_DOWN_MS);
+}
@@ -0,0 +1,49 @@
+#ifndef ACTUATOR_TIMING_H
+#define ACTUATOR_TIMING_H
+
+#include <Arduino.h>
+
+// Feedback taps used only while characterizing: the front left servo's
+// potentiometer wiper, and the left motor group's current sense resistor.
+// Both are ADC1 input-only pins, so readings work with WiFi up.
+const int SERVO_FEEDBACK_PIN = 36;
+const int MOTOR_SENSE_PIN = 39;
+
+// A reading is settled once it has left SETTLE_BAND_COUNTS of where it started
+// and SETTLE_SAMPLES consecutive samples, taken every SETTLE_SAMPLE_MS, stay
+// within SETTLE_BAND_COUNTS of each other
+const int SETTLE_SAMPLES = 10;
+const int SETTLE_SAMPLE_MS = 2;
+const int SETTLE_BAND_COUNTS = 24;
+const unsigned long SETTLE_TIMEOUT_MS = 3000;
+const int SETTLE_MARGIN_MS = 20;     // added to every measured time
+const int CHARACTERIZE_TRIALS = 3;
+const int MIN_SERVO_SETTLE_MS = 20;   // one servo PWM frame
+
+// Motor current only settles the moment the drive is cut, not when the wheels
+// stop, and there are no encoders to watch them coast. Stopping waits this
+// long: generous for the wheels coasting down from full speed.
+const unsigned long MOTOR_SPIN_DOWN_MS = 800;
+
+// Servo settle time is modelled as deadMs + msPerDegree * |angle step|
+struct ActuatorTiming {
+  uint8_t version;
+  uint16_t servoDeadMs;
+  float servoMsPerDegree;
+  uint16_t motorSpinUpMs;
+};
+
+// Loads the stored characterization, or conservative defaults if there is none
+void setupActuatorTiming();
+
+unsigned long servoSettleMs(int fromAngle, int toAngle);
+unsigned long motorSpinUpMs();
+unsigned long motorSpinDownMs();
+
+// Steps the servos and runs up the motors to measure the above, then stores the
+// results in NVS. Blocks for several seconds: rover on a stand, parked.
+bool characterizeActuators();
+
+void printActuatorTiming();
+
+#endif //ACTUATOR_TIMING_H
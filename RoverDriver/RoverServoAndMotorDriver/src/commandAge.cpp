@@ -0,0 +1,41 @@
+#include "commandAge.h"
+
+const int AGE_BUCKETS = 6;
+const unsigned long AGE_BUCKET_LIMITS_MS[AGE_BUCKETS - 1] = {250, 500, 1000, 2000, 4000};
+
+unsigned long ageHistogram[AGE_BUCKETS];
+unsigned long agedCommands = 0;
+unsigned long totalAgeMs = 0;
+unsigned long worstAgeMs = 0;
+unsigned long truncatedCommands = 0;
+unsigned long expiredCommands = 0;
+
+void recordCommandAge(unsigned long ageMs, CommandFreshness freshness) {
+  int bucket = 0;
+  while (bucket < AGE_BUCKETS - 1 && ageMs >= AGE_BUCKET_LIMITS_MS[bucket]) {
+    bucket++;
+  }
+  ageHistogram[bucket]++;
+  agedCommands++;
+  totalAgeMs += ageMs;
+  worstAgeMs = max(worstAgeMs, ageMs);
+
+  if (freshness == COMMAND_TRUNCATED) {
+    truncatedCommands++;
+  } else if (freshness == COMMAND_EXPIRED) {
+    expiredCommands++;
+  }
+}
+
+void printCommandAgeStats() {
+  Serial.printf("[Age] Commands: %lu, mean age %lu ms, worst %lu ms\n", agedCommands,
+                agedCommands ? totalAgeMs / agedCommands : 0, worstAgeMs);
+  Serial.printf("[Age] Cut short at deadline: %lu, expired: %lu\n", truncatedCommands, expiredCommands);
+  for (int i = 0; i < AGE_BUCKETS; i++) {
+    if (i < AGE_BUCKETS - 1) {
+      Serial.printf("  < %lu ms: %lu\n", AGE_BUCKET_LIMITS_MS[i], ageHistogram[i]);
+    } else {
+      Serial.printf("  >= %lu ms: %lu\n", AGE_BUCKET_LIMITS_MS[i - 1], ageHistogram[i]);
+    }
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef COMMAND_AGE_H
+#define COMMAND_AGE_H
+
+#include <Arduino.h>
+
+enum CommandFreshness : uint8_t {
+  COMMAND_FRESH,
+  COMMAND_TRUNCATED,   // ran, but cut short at its deadline
+  COMMAND_EXPIRED,     // past its deadline, downgraded to STOP
+};
+
+// Age is measured from frame capture to execution on the rover
+void recordCommandAge(unsigned long ageMs, CommandFreshness freshness);
+void printCommandAgeStats();
+
+#endif //COMMAND_AGE_H
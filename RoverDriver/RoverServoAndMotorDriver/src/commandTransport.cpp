@@ -0,0 +1,179 @@
+#include "commandTransport.h"
+
+void stampCommandMessage(CommandMessage& message, bool stamped, unsigned long ageMs, unsigned long validForMs) {
+  unsigned long now = millis();
+  message.stamped = stamped;
+  message.capturedAtMs = now - (stamped ? ageMs : 0);
+  message.deadlineMs = message.capturedAtMs + (stamped ? validForMs : DEFAULT_COMMAND_VALIDITY_MS);
+}
+
+HttpCommandTransport::HttpCommandTransport(const char* endpoint) : endpoint(endpoint) {}
+
+bool HttpCommandTransport::fetchCommand(const String& lastCommand, const RoverTelemetry& telemetry, CommandMessage& message) {
+  HTTPClient http;
+  String serverPath = String(endpoint) + "?lastCommand=" + lastCommand + "&telemetry=" + encodeTelemetry(telemetry);
+
+  http.begin(serverPath.c_str());
+  const char* stampHeaders[] = {"X-Capture-Age", "X-Valid-For", "X-Decision-Seq", "X-Obstacles"};
+  http.collectHeaders(stampHeaders, 4);
+
+  int httpResponseCode = http.GET();
+  bool received = false;
+
+  if (httpResponseCode > 0) {
+    Serial.print("HTTP Response code: ");
+    Serial.println(httpResponseCode);
+    String payload = http.getString();
+    Serial.println("Response: " + payload);
+
+    if (payload.length() > 0) {
+      message.command = payload;
+      bool stamped = http.hasHeader("X-Capture-Age") && http.hasHeader("X-Valid-For");
+      stampCommandMessage(message, stamped, http.header("X-Capture-Age").toInt(), http.header("X-Valid-For").toInt());
+      message.decisionSeq = http.header("X-Decision-Seq").toInt();
+      message.hasObstacleReport =
+          http.hasHeader("X-Obstacles") && decodeObstacles(http.header("X-Obstacles"), message.obstacles);
+      received = true;
+    }
+  } else {
+    Serial.print("Error code: ");
+    Serial.println(httpResponseCode);
+  }
+
+  http.end();
+  return received;
+}
+
+// "http://192.168.1.20/" -> "192.168.1.20"
+String hostFromEndpoint(const char* endpoint) {
+  String host = endpoint;
+  int schemeEnd = host.indexOf("://");
+  if (schemeEnd >= 0) {
+    host = host.substring(schemeEnd + 3);
+  }
+  int pathStart = host.indexOf('/');
+  if (pathStart >= 0) {
+    host = host.substring(0, pathStart);
+  }
+  int portStart = host.indexOf(':');
+  if (portStart >= 0) {
+    host = host.substring(0, portStart);
+  }
+  return host;
+}
+
+UdpCommandTransport::UdpCommandTransport(const char* endpoint, uint16_t port)
+  : PacketCommandTransport(UDP_ACK_TIMEOUT_MS), host(hostFromEndpoint(endpoint)), port(port) {}
+
+void UdpCommandTransport::begin() {
+  udp.begin(port);
+  Serial.println("[UDP] Command transport to " + host + ":" + String(port));
+}
+
+bool UdpCommandTransport::writePacket(const uint8_t* data, size_t length) {
+  udp.beginPacket(host.c_str(), port);
+  udp.write(data, length);
+  return udp.endPacket() == 1;
+}
+
+size_t UdpCommandTransport::readPacket(CommandPacket& packet) {
+  if (udp.parsePacket() <= 0) {
+    return 0;
+  }
+  int received = udp.read((unsigned char*)&packet, sizeof(packet));
+  return received > 0 ? received : 0;
+}
+
+PacketCommandTransport::PacketCommandTransport(unsigned long ackTimeoutMs) : ackTimeoutMs(ackTimeoutMs) {}
+
+bool PacketCommandTransport::dropInjected() const {
+  return injectedLossPercent > 0 && random(100) < injectedLossPercent;
+}
+
+bool PacketCommandTransport::send(PacketType type, uint16_t seq, const uint8_t* payload, size_t length) {
+  if (dropInjected()) {
+    return true;
+  }
+  CommandPacket packet;
+  length = buildPacket(packet, type, seq, payload, length);
+  return writePacket((const uint8_t*)&packet, length);
+}
+
+bool PacketCommandTransport::receive(PacketType type, uint16_t seq, unsigned long timeoutMs, CommandPacket& packet) {
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    size_t received = readPacket(packet);
+    if (received == 0) {
+      delay(1);
+      continue;
+    }
+    if (dropInjected() || !validPacket(packet, received)) {
+      continue;
+    }
+    if (packet.header.seq != seq) {
+      continue;   // late answer to an earlier request
+    }
+    if (packet.header.type == type || packet.header.type == PACKET_COMMAND) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PacketCommandTransport::fetchCommand(const String& lastCommand, const RoverTelemetry& telemetry, CommandMessage& message) {
+  uint8_t request[MAX_PACKET_PAYLOAD];
+  size_t requestLength = buildRequestPayload(request, lastCommand, telemetry);
+  uint16_t seq = nextSeq++;
+  unsigned long start = millis();
+  requests++;
+
+  for (int attempt = 0; attempt < PACKET_MAX_ATTEMPTS; attempt++) {
+    if (attempt > 0) {
+      retries++;
+      Serial.printf("[%s] Retrying seq %u (attempt %d)\n", name(), seq, attempt + 1);
+    }
+    unsigned long sentAtUs = micros();
+    send(PACKET_REQUEST, seq, request, requestLength);
+
+    CommandPacket packet;
+    if (!receive(PACKET_ACK, seq, ackTimeoutMs, packet)) {
+      continue;
+    }
+    unsigned long ackUs = micros() - sentAtUs;
+    acks++;
+    totalAckUs += ackUs;
+    worstAckUs = max(worstAckUs, ackUs);
+
+    if (packet.header.type != PACKET_COMMAND && !receive(PACKET_COMMAND, seq, RESPONSE_TIMEOUT_MS, packet)) {
+      continue;
+    }
+
+    send(PACKET_ACK, seq, nullptr, 0);
+    CommandStamp stamp;
+    if (!parseCommandPayload(packet, message.command, stamp, message.hasObstacleReport, message.obstacles)) {
+      continue;
+    }
+    stampCommandMessage(message, true, stamp.ageMs, stamp.validForMs);
+    message.decisionSeq = stamp.decisionSeq;
+
+    unsigned long latency = millis() - start;
+    totalLatencyMs += latency;
+    if (latency > worstLatencyMs) {
+      worstLatencyMs = latency;
+    }
+    return true;
+  }
+
+  failures++;
+  return false;
+}
+
+void PacketCommandTransport::printStats() const {
+  unsigned long delivered = requests - failures;
+  Serial.printf("[%s] Requests: %lu, retries: %lu, failed: %lu, injected loss: %d%%\n", name(), requests, retries,
+                failures, injectedLossPercent);
+  Serial.printf("[%s] Delivery latency mean: %lu ms, worst: %lu ms\n", name(),
+                delivered ? totalLatencyMs / delivered : 0, worstLatencyMs);
+  Serial.printf("[%s] Link round trip (request to ack) mean: %lu us, worst: %lu us\n", name(),
+                acks ? totalAckUs / acks : 0, worstAckUs);
+}
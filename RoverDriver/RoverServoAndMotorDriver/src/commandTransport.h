@@ -0,0 +1,116 @@
+#ifndef COMMAND_TRANSPORT_H
+#define COMMAND_TRANSPORT_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiUdp.h>
+#include "commandPacket.h"
+
+const unsigned long DEFAULT_COMMAND_VALIDITY_MS = 3000;   // for cameras that don't stamp commands
+
+// A command with its capture time and deadline mapped onto our millis() clock,
+// and the obstacles the camera saw in the same frame
+struct CommandMessage {
+  String command;
+  unsigned long capturedAtMs;
+  unsigned long deadlineMs;
+  bool stamped;
+  bool hasObstacleReport;   // an empty report means the camera saw nothing
+  ObstacleReport obstacles;
+  uint16_t decisionSeq;     // the camera's decision behind this command, 0 if unknown
+};
+
+// How the rover asks the camera for its next command
+class CommandTransport {
+public:
+  virtual ~CommandTransport() {}
+  virtual void begin() {}
+
+  // Reports the last executed command and telemetry, and fetches the next
+  // command. Returns false if no command could be fetched.
+  virtual bool fetchCommand(const String& lastCommand, const RoverTelemetry& telemetry, CommandMessage& message) = 0;
+  virtual const char* name() const = 0;
+  virtual void printStats() const {}
+};
+
+// GET <serverEndpoint>?lastCommand=...&telemetry=<hex>, the response body is
+// the command and X-Capture-Age / X-Valid-For headers carry its stamp,
+// X-Decision-Seq its decision and X-Obstacles the camera's obstacle report
+class HttpCommandTransport : public CommandTransport {
+public:
+  explicit HttpCommandTransport(const char* endpoint);
+  bool fetchCommand(const String& lastCommand, const RoverTelemetry& telemetry, CommandMessage& message) override;
+  const char* name() const override { return "HTTP"; }
+
+private:
+  const char* endpoint;
+};
+
+const int PACKET_MAX_ATTEMPTS = 4;
+// The camera answers straight after the ack from its cached decision, so a
+// missing answer is a lost packet, retried like a missing ack. loop() is
+// held for at most PACKET_MAX_ATTEMPTS * (ack + response timeout).
+const unsigned long RESPONSE_TIMEOUT_MS = 300;
+
+// Request/command packets with sequence numbers over any packet link. The
+// camera acks a request straight away, then answers with a COMMAND for the
+// same seq. A request is retried if the ack or the answer doesn't arrive; the
+// camera replays its cached answer for a repeated seq instead of analysing
+// another frame.
+class PacketCommandTransport : public CommandTransport {
+public:
+  explicit PacketCommandTransport(unsigned long ackTimeoutMs);
+  bool fetchCommand(const String& lastCommand, const RoverTelemetry& telemetry, CommandMessage& message) override;
+  void printStats() const override;
+
+  // Drops this percentage of packets in both directions to exercise recovery
+  void setInjectedLoss(int percent) { injectedLossPercent = percent; }
+
+protected:
+  virtual bool writePacket(const uint8_t* data, size_t length) = 0;
+  // Non-blocking, returns the size of a received packet or 0
+  virtual size_t readPacket(CommandPacket& packet) = 0;
+
+private:
+  bool send(PacketType type, uint16_t seq, const uint8_t* payload, size_t length);
+  // Waits for a packet of the given type for seq; other packets are discarded
+  bool receive(PacketType type, uint16_t seq, unsigned long timeoutMs, CommandPacket& packet);
+  bool dropInjected() const;
+
+  unsigned long ackTimeoutMs;
+  uint16_t nextSeq = 1;
+  int injectedLossPercent = 0;
+
+  unsigned long requests = 0;
+  unsigned long retries = 0;
+  unsigned long failures = 0;
+  unsigned long totalLatencyMs = 0;
+  unsigned long worstLatencyMs = 0;
+  unsigned long acks = 0;
+  unsigned long totalAckUs = 0;   // link round trip, request to ack
+  unsigned long worstAckUs = 0;
+};
+
+const unsigned long UDP_ACK_TIMEOUT_MS = 300;
+
+class UdpCommandTransport : public PacketCommandTransport {
+public:
+  UdpCommandTransport(const char* endpoint, uint16_t port);
+  void begin() override;
+  const char* name() const override { return "UDP"; }
+
+protected:
+  bool writePacket(const uint8_t* data, size_t length) override;
+  size_t readPacket(CommandPacket& packet) override;
+
+private:
+  String host;
+  uint16_t port;
+  WiFiUDP udp;
+};
+
+// Maps a stamp relative to "now" onto local time. Transit time of the answer is
+// ignored, which makes commands look slightly younger than they are.
+void stampCommandMessage(CommandMessage& message, bool stamped, unsigned long ageMs, unsigned long validForMs);
+
+#endif //COMMAND_TRANSPORT_H
@@ -0,0 +1,182 @@
+#include "drive.h"
+#include "odometry.h"
+#include "flightRecorder.h"
+
+//SERVO SETUP
+Servo frontLeftServo;
+Servo frontRightServo;
+Servo backLeftServo;
+Servo backRightServo;
+
+const int SERVO_FRONT_LEFT_PIN = 16;
+const int SERVO_FRONT_RIGHT_PIN = 17;
+const int SERVO_BACK_LEFT_PIN = 18;
+const int SERVO_BACK_RIGHT_PIN = 19;
+
+// L298N MOTOR SETUP
+const int F_MOTOR_LEFT_IN1 = 2;   // F-Left motor control pin 1
+const int F_MOTOR_LEFT_IN2 = 4;   // F-Left motor control pin 2
+const int F_MOTOR_RIGHT_IN3 = 5;  // F-Right motor control pin 1
+const int F_MOTOR_RIGHT_IN4 = 13; // F-Right motor control pin 2
+
+const int M_MOTOR_LEFT_IN1 = 14;   // M-Left motor control pin 1
+const int M_MOTOR_LEFT_IN2 = 12;   // M-Left motor control pin 2
+const int M_MOTOR_RIGHT_IN3 = 15;  // M-Right motor control pin 1
+const int M_MOTOR_RIGHT_IN4 = 27; // M-Right motor control pin 2
+
+const int B_MOTOR_LEFT_IN1 = 26;   // B-Left motor control pin 1
+const int B_MOTOR_LEFT_IN2 = 25;   // B-Left motor control pin 2
+const int B_MOTOR_RIGHT_IN3 = 33;  // B-Right motor control pin 1
+const int B_MOTOR_RIGHT_IN4 = 32; // B-Right motor control pin 2
+
+const int MOTOR_PWM_BITS = 8;
+
+// One PWM channel per side and direction, routed to all three motors on that side
+ESP32PWM leftForwardPwm;
+ESP32PWM leftBackwardPwm;
+ESP32PWM rightForwardPwm;
+ESP32PWM rightBackwardPwm;
+
+// The loop and the safety task both drive the motors. Writes hold this lock
+// (recursive, applyDrive takes it around setSteering and setMotorSpeeds).
+SemaphoreHandle_t driveMutex;
+volatile bool forwardInhibited = false;
+
+// Written from both the loop and the safety task
+volatile int currentDirection = 0;
+volatile int currentLeftSpeed = 0;
+volatile int currentRightSpeed = 0;
+volatile int currentSteeringAngle = CENTER_ANGLE;
+
+void attachMotorGroup(ESP32PWM& pwm, int frontPin, int middlePin, int backPin) {
+  pwm.attachPin(frontPin, MOTOR_PWM_HZ, MOTOR_PWM_BITS);
+  pwm.attachPin(middlePin);
+  pwm.attachPin(backPin);
+}
+
+void setupDrive() {
+  driveMutex = xSemaphoreCreateRecursiveMutex();
+
+  // SERVO TIMERS
+  ESP32PWM::allocateTimer(0);
+  ESP32PWM::allocateTimer(1);
+  ESP32PWM::allocateTimer(2);
+  ESP32PWM::allocateTimer(3);
+  
+  // SERVO FREQUENCIES
+  frontLeftServo.setPeriodHertz(50);
+  frontRightServo.setPeriodHertz(50);
+  backLeftServo.setPeriodHertz(50);
+  backRightServo.setPeriodHertz(50);
+  
+  // SERVO ATTACHMENTS
+  frontLeftServo.attach(SERVO_FRONT_LEFT_PIN, 500, 2500);
+  frontRightServo.attach(SERVO_FRONT_RIGHT_PIN, 500, 2500);
+  backLeftServo.attach(SERVO_BACK_LEFT_PIN, 500, 2500);
+  backRightServo.attach(SERVO_BACK_RIGHT_PIN, 500, 2500);
+  
+  Serial.println("Servos initialized");
+  
+  // MOTOR PWM, attached after the servos so they land on the remaining timers
+  attachMotorGroup(leftForwardPwm, F_MOTOR_LEFT_IN1, M_MOTOR_LEFT_IN1, B_MOTOR_LEFT_IN1);
+  attachMotorGroup(leftBackwardPwm, F_MOTOR_LEFT_IN2, M_MOTOR_LEFT_IN2, B_MOTOR_LEFT_IN2);
+  attachMotorGroup(rightForwardPwm, F_MOTOR_RIGHT_IN3, M_MOTOR_RIGHT_IN3, B_MOTOR_RIGHT_IN3);
+  attachMotorGroup(rightBackwardPwm, F_MOTOR_RIGHT_IN4, M_MOTOR_RIGHT_IN4, B_MOTOR_RIGHT_IN4);
+  
+  stopMotors();
+}
+
+void writeMotorSide(ESP32PWM& forwardPwm, ESP32PWM& backwardPwm, int speed) {
+  uint32_t duty = abs(speed) * ((1 << MOTOR_PWM_BITS) - 1) / MAX_SPEED;
+  forwardPwm.write(speed > 0 ? duty : 0);
+  backwardPwm.write(speed < 0 ? duty : 0);
+}
+
+void setMotorSpeeds(int leftSpeed, int rightSpeed) {
+  leftSpeed = constrain(leftSpeed, -MAX_SPEED, MAX_SPEED);
+  rightSpeed = constrain(rightSpeed, -MAX_SPEED, MAX_SPEED);
+  xSemaphoreTakeRecursive(driveMutex, portMAX_DELAY);
+  if (forwardInhibited) {
+    leftSpeed = min(leftSpeed, 0);
+    rightSpeed = min(rightSpeed, 0);
+  }
+  updateOdometry();
+  writeMotorSide(leftForwardPwm, leftBackwardPwm, leftSpeed);
+  writeMotorSide(rightForwardPwm, rightBackwardPwm, rightSpeed);
+
+  currentLeftSpeed = leftSpeed;
+  currentRightSpeed = rightSpeed;
+  int direction = leftSpeed + rightSpeed;
+  currentDirection = direction > 0 ? 1 : (direction < 0 ? -1 : 0);
+  recordFlightEvent(FLIGHT_DRIVE, currentSteeringAngle, leftSpeed, rightSpeed);
+  xSemaphoreGiveRecursive(driveMutex);
+}
+
+void setForwardInhibit(bool inhibit) {
+  xSemaphoreTakeRecursive(driveMutex, portMAX_DELAY);
+  forwardInhibited = inhibit;
+  xSemaphoreGiveRecursive(driveMutex);
+}
+
+void stopMotors() {
+  setMotorSpeeds(0, 0);
+}
+
+int steeringAngleFor(int curvature) {
+  return map(constrain(curvature, -MAX_CURVATURE, MAX_CURVATURE), -MAX_CURVATURE, MAX_CURVATURE, LEFT_ANGLE,
+             RIGHT_ANGLE);
+}
+
+void setSteering(int curvature) {
+  int angle = steeringAngleFor(curvature);
+  xSemaphoreTakeRecursive(driveMutex, portMAX_DELAY);
+  updateOdometry();
+  currentSteeringAngle = angle;
+  recordFlightEvent(FLIGHT_DRIVE, angle, currentLeftSpeed, currentRightSpeed);
+  frontLeftServo.write(angle);
+  frontRightServo.write(angle);
+  backLeftServo.write(angle);
+  backRightServo.write(angle);
+  xSemaphoreGiveRecursive(driveMutex);
+}
+
+void centerWheels() {
+  Serial.println("Centering");
+  setSteering(0);
+}
+
+// Slow the inner side in proportion to how hard we are turning
+void sideSpeedsFor(const DriveCommand& command, int& leftSpeed, int& rightSpeed) {
+  float innerScale = 1.0 - (1.0 - TURN_INNER_SPEED_RATIO) * abs(command.curvature) / MAX_CURVATURE;
+  int innerSpeed = lroundf(command.speed * innerScale);
+  leftSpeed = command.curvature < 0 ? innerSpeed : command.speed;
+  rightSpeed = command.curvature < 0 ? command.speed : innerSpeed;
+}
+
+void applyDrive(const DriveCommand& command) {
+  Serial.printf("Driving: curvature %d, speed %d for %u ms\n", command.curvature, command.speed, command.durationMs);
+  int leftSpeed;
+  int rightSpeed;
+  sideSpeedsFor(command, leftSpeed, rightSpeed);
+
+  xSemaphoreTakeRecursive(driveMutex, portMAX_DELAY);
+  setSteering(command.curvature);
+  setMotorSpeeds(leftSpeed, rightSpeed);
+  xSemaphoreGiveRecursive(driveMutex);
+}
+
+int leftMotorSpeed() {
+  return currentLeftSpeed;
+}
+
+int rightMotorSpeed() {
+  return currentRightSpeed;
+}
+
+int steeringAngle() {
+  return currentSteeringAngle;
+}
+
+int driveDirection() {
+  return currentDirection;
+}
@@ -0,0 +1,40 @@
+#ifndef DRIVE_H
+#define DRIVE_H
+
+#include <Arduino.h>
+#include <ESP32Servo.h>
+#include "driveCommand.h"
+
+// CONSTANTS
+const int CENTER_ANGLE = 90;
+const int RIGHT_ANGLE = 120;
+const int LEFT_ANGLE = 60;
+const int MOTOR_PWM_HZ = 1000;
+const float TURN_INNER_SPEED_RATIO = 0.5;   // inner side speed at full curvature
+
+void setupDrive();
+
+// Maps a continuous command straight onto servo angle and motor duty
+void applyDrive(const DriveCommand& command);
+void setSteering(int curvature);
+// Signed speeds from -MAX_SPEED to MAX_SPEED for each side
+void setMotorSpeeds(int leftSpeed, int rightSpeed);
+// While set, forward speeds are written as 0. The safety task sets it before
+// stopping, so a write already on its way from loop() can't restart the motors.
+void setForwardInhibit(bool inhibit);
+
+// What applyDrive() sets for a command, for anything that predicts motion
+int steeringAngleFor(int curvature);
+void sideSpeedsFor(const DriveCommand& command, int& leftSpeed, int& rightSpeed);
+
+void stopMotors();
+void centerWheels();
+
+int leftMotorSpeed();
+int rightMotorSpeed();
+int steeringAngle();
+
+// 1 while driving forward, -1 while reversing, 0 when the motors are off
+int driveDirection();
+
+#endif //DRIVE_H
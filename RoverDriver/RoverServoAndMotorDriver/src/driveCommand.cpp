@@ -0,0 +1,73 @@
+#include "driveCommand.h"
+
+struct DrivePreset {
+  const char* name;
+  DriveCommand command;
+};
+
+const DrivePreset PRESETS[] = {
+  {"STOP", STOP_PRESET},
+  {"FULL_STOP", STOP_PRESET},
+  {"FORWARD", FORWARD_PRESET},
+  {"BACKWARD", BACKWARD_PRESET},
+  {"TURN_LEFT", TURN_LEFT_PRESET},
+  {"TURN_RIGHT", TURN_RIGHT_PRESET},
+};
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseHexByte(const char* text, uint8_t& value) {
+  int high = hexValue(text[0]);
+  int low = hexValue(text[1]);
+  if (high < 0 || low < 0) {
+    return false;
+  }
+  value = (high << 4) | low;
+  return true;
+}
+
+bool parseDriveCommand(const String& text, DriveCommand& command) {
+  for (const DrivePreset& preset : PRESETS) {
+    if (text == preset.name) {
+      command = preset.command;
+      return true;
+    }
+  }
+
+  if (text.length() != 7 || text[0] != 'D') {
+    return false;
+  }
+  uint8_t curvature, speed, steps;
+  const char* digits = text.c_str() + 1;
+  if (!parseHexByte(digits, curvature) || !parseHexByte(digits + 2, speed) || !parseHexByte(digits + 4, steps)) {
+    return false;
+  }
+  command.curvature = max((int8_t)-MAX_CURVATURE, (int8_t)curvature);
+  command.speed = max((int8_t)-MAX_SPEED, (int8_t)speed);
+  command.durationMs = steps * DURATION_STEP_MS;
+  return true;
+}
+
+String encodeDriveCommand(const DriveCommand& command) {
+  char encoded[8];
+  snprintf(encoded, sizeof(encoded), "D%02X%02X%02X", (uint8_t)command.curvature, (uint8_t)command.speed,
+           (uint8_t)min(255, command.durationMs / DURATION_STEP_MS));
+  return String(encoded);
+}
+
+DriveCommand makeDriveCommand(float curvature, float speed, unsigned long durationMs) {
+  DriveCommand command;
+  command.curvature = lroundf(constrain(curvature, -1.0f, 1.0f) * MAX_CURVATURE);
+  command.speed = lroundf(constrain(speed, -1.0f, 1.0f) * MAX_SPEED);
+  command.durationMs = min(255UL, (durationMs + DURATION_STEP_MS / 2) / DURATION_STEP_MS) * DURATION_STEP_MS;
+  return command;
+}
+
+bool isStopCommand(const DriveCommand& command) {
+  return command.speed == 0 || command.durationMs == 0;
+}
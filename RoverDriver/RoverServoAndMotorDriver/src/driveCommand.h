@@ -0,0 +1,36 @@
+#ifndef DRIVE_COMMAND_H
+#define DRIVE_COMMAND_H
+
+#include <Arduino.h>
+
+const int MOVEMENT_DELAY = 2000;
+const int MAX_CURVATURE = 127;
+const int MAX_SPEED = 127;
+const int DURATION_STEP_MS = 20;   // duration resolution on the wire, 8 bits covers 5.1s
+
+// Continuous motion command. Curvature steers from full left (-127) to full
+// right (127), speed runs from full reverse (-127) to full forward (127).
+struct DriveCommand {
+  int8_t curvature;
+  int8_t speed;
+  uint16_t durationMs;
+};
+
+// The original command verbs are presets of the continuous form
+const DriveCommand STOP_PRESET = {0, 0, 0};
+const DriveCommand FORWARD_PRESET = {0, MAX_SPEED, MOVEMENT_DELAY};
+const DriveCommand BACKWARD_PRESET = {0, -MAX_SPEED, MOVEMENT_DELAY};
+const DriveCommand TURN_LEFT_PRESET = {-MAX_CURVATURE, MAX_SPEED, MOVEMENT_DELAY};
+const DriveCommand TURN_RIGHT_PRESET = {MAX_CURVATURE, MAX_SPEED, MOVEMENT_DELAY};
+
+// Accepts a preset verb (FORWARD, TURN_LEFT, ...) or the compact "Dccssdd" form:
+// 'D' followed by curvature, speed and duration steps as two hex digits each.
+bool parseDriveCommand(const String& text, DriveCommand& command);
+String encodeDriveCommand(const DriveCommand& command);
+
+// Quantizes curvature and speed given in -1..1 and a duration in ms
+DriveCommand makeDriveCommand(float curvature, float speed, unsigned long durationMs);
+
+bool isStopCommand(const DriveCommand& command);
+
+#endif //DRIVE_COMMAND_H
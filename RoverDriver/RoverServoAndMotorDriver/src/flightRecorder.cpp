@@ -0,0 +1,244 @@
+#include "flightRecorder.h"
+#include <esp_partition.h>
+#include <esp_system.h>
+#include "drive.h"
+
+const esp_partition_type_t FLIGHT_PARTITION_TYPE = (esp_partition_type_t)0x40;
+const esp_partition_subtype_t FLIGHT_PARTITION_SUBTYPE = (esp_partition_subtype_t)0x01;
+const int RECORDS_PER_SECTOR = FLIGHT_SECTOR_SIZE / sizeof(FlightRecord);
+
+const esp_partition_t* flightPartition = nullptr;
+uint32_t sectorCount = 0;
+
+// Staging ring, filled from any task and drained by the writer
+portMUX_TYPE stagingMux = portMUX_INITIALIZER_UNLOCKED;
+FlightRecord staging[FLIGHT_STAGING_RECORDS];
+int stagingHead = 0;
+int stagingCount = 0;
+uint8_t nextSequence = 0;
+unsigned long droppedEvents = 0;
+
+// Writer task state
+uint32_t currentSector = 0;
+int nextSlot = RECORDS_PER_SECTOR;   // record slot in currentSector, 0 is the header
+bool nextSectorErased = false;       // the sector after currentSector is blank
+uint32_t sectorSequence = 0;
+uint32_t bootCount = 0;
+unsigned long recordsWritten = 0;
+unsigned long sectorsErased = 0;
+unsigned long erasesWhileDriving = 0;
+unsigned long worstFlushUs = 0;
+unsigned long flashErrors = 0;
+volatile bool eraseRequested = false;
+uint32_t eraseProgress = 0;   // sectors erased so far by a requested erase
+
+void recordFlightEvent(FlightEventType type, int16_t a, int32_t b, int32_t c) {
+  FlightRecord record;
+  record.timeMs = millis();
+  record.type = type;
+  record.a = a;
+  record.b = b;
+  record.c = c;
+
+  portENTER_CRITICAL(&stagingMux);
+  record.sequence = nextSequence++;
+  if (stagingCount < FLIGHT_STAGING_RECORDS) {
+    staging[(stagingHead + stagingCount) % FLIGHT_STAGING_RECORDS] = record;
+    stagingCount++;
+  } else {
+    droppedEvents++;
+  }
+  portEXIT_CRITICAL(&stagingMux);
+}
+
+uint32_t followingSector() {
+  return (currentSector + 1) % sectorCount;
+}
+
+bool motorsIdle() {
+  return leftMotorSpeed() == 0 && rightMotorSpeed() == 0;
+}
+
+void eraseSector(uint32_t sector) {
+  if (esp_partition_erase_range(flightPartition, sector * FLIGHT_SECTOR_SIZE, FLIGHT_SECTOR_SIZE) != ESP_OK) {
+    flashErrors++;
+  }
+  sectorsErased++;
+}
+
+// An erase holds the flash, and with it the caches of both cores, for tens
+// of ms. That would stall the safety task and the echo ISR, so it's done
+// while the rover is parked, well before the sector is needed.
+void preEraseNextSector() {
+  if (!nextSectorErased && sectorCount > 1 && motorsIdle()) {
+    eraseSector(followingSector());
+    nextSectorErased = true;
+  }
+}
+
+// Moves on to the next sector in the ring and writes its header
+void startSector() {
+  currentSector = followingSector();
+  if (!nextSectorErased) {
+    if (!motorsIdle()) {
+      erasesWhileDriving++;
+    }
+    eraseSector(currentSector);
+  }
+  nextSectorErased = false;
+  uint32_t offset = currentSector * FLIGHT_SECTOR_SIZE;
+
+  FlightSectorHeader header = {FLIGHT_SECTOR_MAGIC, ++sectorSequence, bootCount, FLIGHT_FORMAT_VERSION, 0};
+  if (esp_partition_write(flightPartition, offset, &header, sizeof(header)) != ESP_OK) {
+    flashErrors++;
+  }
+  nextSlot = 1;
+}
+
+// Writes a batch, split where it crosses into the next sector
+void writeRecords(const FlightRecord* records, int count) {
+  while (count > 0) {
+    if (nextSlot >= RECORDS_PER_SECTOR) {
+      startSector();
+    }
+    int chunk = min(count, RECORDS_PER_SECTOR - nextSlot);
+    uint32_t offset = currentSector * FLIGHT_SECTOR_SIZE + nextSlot * sizeof(FlightRecord);
+    if (esp_partition_write(flightPartition, offset, records, chunk * sizeof(FlightRecord)) != ESP_OK) {
+      flashErrors++;
+    }
+    nextSlot += chunk;
+    recordsWritten += chunk;
+    records += chunk;
+    count -= chunk;
+  }
+}
+
+void flushStaging() {
+  FlightRecord batch[FLIGHT_STAGING_RECORDS];
+  int count = 0;
+  portENTER_CRITICAL(&stagingMux);
+  // Writing these would need an erase under way, hold them until the motors stop
+  bool needsErase = !nextSectorErased && nextSlot + stagingCount > RECORDS_PER_SECTOR;
+  if (needsErase && stagingCount < FLIGHT_DEFER_RECORDS && !motorsIdle()) {
+    portEXIT_CRITICAL(&stagingMux);
+    return;
+  }
+  while (stagingCount > 0) {
+    batch[count++] = staging[stagingHead];
+    stagingHead = (stagingHead + 1) % FLIGHT_STAGING_RECORDS;
+    stagingCount--;
+  }
+  portEXIT_CRITICAL(&stagingMux);
+
+  if (count > 0) {
+    unsigned long start = micros();
+    writeRecords(batch, count);
+    worstFlushUs = max(worstFlushUs, micros() - start);
+  }
+}
+
+// The whole partition in one call would hold the flash for seconds. It goes
+// a sector at a time, yielding in between, and only while the motors are
+// off; if they start it picks up again on a later tick once they stop.
+void eraseLog() {
+  if (eraseProgress == 0) {
+    portENTER_CRITICAL(&stagingMux);
+    stagingCount = 0;
+    portEXIT_CRITICAL(&stagingMux);
+  }
+  while (eraseProgress < sectorCount && motorsIdle()) {
+    eraseSector(eraseProgress++);
+    vTaskDelay(1);
+  }
+  if (eraseProgress < sectorCount) {
+    return;
+  }
+  currentSector = sectorCount - 1;
+  nextSectorErased = true;
+  sectorSequence = 0;
+  nextSlot = RECORDS_PER_SECTOR;
+  eraseProgress = 0;
+  eraseRequested = false;
+  Serial.println("[Recorder] Erased");
+}
+
+// Low priority on core 0, away from loop() and the safety task. Flash
+// writes still pause both caches briefly; the long sector erases wait for
+// the motors to be off.
+void flightWriterTask(void* param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  while (true) {
+    if (eraseRequested) {
+      eraseLog();
+    }
+    // Nothing is written into a log that is half erased, records wait in staging
+    if (!eraseRequested) {
+      preEraseNextSector();
+      flushStaging();
+    }
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(FLIGHT_WRITER_PERIOD_MS));
+  }
+}
+
+// The newest sector has the highest sequence; every boot continues after it
+void findLogEnd() {
+  bool found = false;
+  for (uint32_t sector = 0; sector < sectorCount; sector++) {
+    FlightSectorHeader header;
+    if (esp_partition_read(flightPartition, sector * FLIGHT_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+      continue;
+    }
+    if (header.magic != FLIGHT_SECTOR_MAGIC || header.version != FLIGHT_FORMAT_VERSION) {
+      continue;
+    }
+    if (!found || header.sectorSequence > sectorSequence) {
+      found = true;
+      currentSector = sector;
+      sectorSequence = header.sectorSequence;
+      bootCount = header.bootCount;
+    }
+  }
+  if (!found) {
+    // Blank or foreign partition: the first startSector() lands on sector 0
+    currentSector = sectorCount - 1;
+  }
+  bootCount++;
+  nextSlot = RECORDS_PER_SECTOR;
+}
+
+void setupFlightRecorder() {
+  flightPartition = esp_partition_find_first(FLIGHT_PARTITION_TYPE, FLIGHT_PARTITION_SUBTYPE, "flightrec");
+  if (!flightPartition) {
+    Serial.println("[Recorder] No flightrec partition, flight recorder disabled");
+    return;
+  }
+  sectorCount = flightPartition->size / FLIGHT_SECTOR_SIZE;
+  findLogEnd();
+  recordFlightEvent(FLIGHT_BOOT, esp_reset_reason());
+  xTaskCreatePinnedToCore(flightWriterTask, "flightrec", 4096, nullptr, 1, nullptr, 0);
+  Serial.printf("[Recorder] Boot %lu, %lu sectors, continuing after sector %lu\n", (unsigned long)bootCount,
+                (unsigned long)sectorCount, (unsigned long)currentSector);
+}
+
+void printFlightRecorderStats() {
+  if (!flightPartition) {
+    Serial.println("[Recorder] Disabled");
+    return;
+  }
+  Serial.printf("[Recorder] Boot %lu, sector %lu of %lu, slot %d\n", (unsigned long)bootCount,
+                (unsigned long)currentSector, (unsigned long)sectorCount, nextSlot);
+  Serial.printf("[Recorder] Written: %lu, dropped: %lu, staged: %d, sectors erased: %lu (%lu while driving), "
+                "flash errors: %lu\n",
+                recordsWritten, droppedEvents, stagingCount, sectorsErased, erasesWhileDriving, flashErrors);
+  Serial.printf("[Recorder] Worst flush: %lu us\n", worstFlushUs);
+}
+
+// Done by the writer task so it never races a write in progress
+void eraseFlightRecorder() {
+  if (flightPartition) {
+    if (!motorsIdle()) {
+      Serial.println("[Recorder] Erase waits until the motors stop");
+    }
+    eraseRequested = true;
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+
+// Binary event log in the "flightrec" partition (see partitions.csv), written
+// as a ring of 4 KB sectors: the sector after the newest is erased ahead of
+// its reuse while the motors are off, so every sector wears at the same rate. Pull it off the board
+// with esptool and decode it with tools/flightrec-decode.js.
+const uint32_t FLIGHT_SECTOR_SIZE = 4096;
+const uint32_t FLIGHT_SECTOR_MAGIC = 0x43455246;   // "FREC"
+const uint16_t FLIGHT_FORMAT_VERSION = 1;
+const int FLIGHT_STAGING_RECORDS = 128;           // RAM between recordFlightEvent() and the writer task
+const int FLIGHT_WRITER_PERIOD_MS = 200;
+// With the motors running and no erased sector ready, records wait in RAM
+// until this many are staged, then the writer erases anyway
+const int FLIGHT_DEFER_RECORDS = FLIGHT_STAGING_RECORDS * 3 / 4;
+
+enum FlightEventType : uint8_t {
+  FLIGHT_BOOT = 1,      // a: reset reason
+  FLIGHT_MODE,          // a: new mode, b: previous mode
+  FLIGHT_COMMAND,       // a: freshness, b: curvature/speed/duration packed, c: age ms
+  FLIGHT_DRIVE,         // a: steering angle, b: left speed, c: right speed
+  FLIGHT_SAFETY_STOP,   // a: distance cm, b: latency us
+  FLIGHT_POLL,          // a: 1 if a command came back, b: round trip ms
+  FLIGHT_WIFI,          // a: 1 connected, 0 lost, b: RSSI
+};
+
+// 16 bytes so a sector holds its header and 255 records. An erased record
+// reads as type 0xFF, which marks the end of the written part of a sector.
+struct __attribute__((packed)) FlightRecord {
+  uint32_t timeMs;
+  uint8_t type;
+  uint8_t sequence;   // low byte of a running count, gaps show dropped events
+  int16_t a;
+  int32_t b;
+  int32_t c;
+};
+
+struct __attribute__((packed)) FlightSectorHeader {
+  uint32_t magic;
+  uint32_t sectorSequence;   // increases by one for every sector started
+  uint32_t bootCount;        // every boot starts a fresh sector
+  uint16_t version;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(FlightRecord) == 16, "Flight records must stay 16 bytes");
+static_assert(sizeof(FlightSectorHeader) == sizeof(FlightRecord), "Sector header takes one record slot");
+
+// Finds the end of the log and starts the writer task
+void setupFlightRecorder();
+
+// Constant time and safe from any task: copies into RAM, never touches flash.
+// Events are dropped (and counted) if the writer falls behind.
+void recordFlightEvent(FlightEventType type, int16_t a = 0, int32_t b = 0, int32_t c = 0);
+
+void printFlightRecorderStats();
+void eraseFlightRecorder();
+
+#endif //FLIGHT_RECORDER_H
@@ -0,0 +1,73 @@
+#include "governor.h"
+
+const GovernorStep GOVERNOR_TABLE[] = {
+  {0, 1.00, 1.00},
+  {1500, 1.00, 1.00},
+  {3000, 0.80, 0.75},
+  {5000, 0.60, 0.50},
+  {8000, 0.40, 0.35},
+  {12000, 0.25, 0.25},
+};
+const int GOVERNOR_STEPS = sizeof(GOVERNOR_TABLE) / sizeof(GOVERNOR_TABLE[0]);
+
+float averageDecisionAgeMs = 0;
+
+unsigned long governedCommands = 0;
+float totalSpeedScale = 0;
+float lowestSpeedScale = 1;
+float totalDistanceScale = 0;
+
+void noteDecisionAge(unsigned long ageMs) {
+  if (averageDecisionAgeMs == 0) {
+    averageDecisionAgeMs = ageMs;
+  } else {
+    averageDecisionAgeMs += DECISION_AGE_SMOOTHING * ((float)ageMs - averageDecisionAgeMs);
+  }
+}
+
+void lookupScales(unsigned long latencyMs, float& speedScale, float& durationScale) {
+  const GovernorStep& last = GOVERNOR_TABLE[GOVERNOR_STEPS - 1];
+  speedScale = last.speedScale;
+  durationScale = last.durationScale;
+
+  for (int i = 1; i < GOVERNOR_STEPS; i++) {
+    const GovernorStep& low = GOVERNOR_TABLE[i - 1];
+    const GovernorStep& high = GOVERNOR_TABLE[i];
+    if (latencyMs < high.latencyMs) {
+      float t = (float)(latencyMs - low.latencyMs) / (high.latencyMs - low.latencyMs);
+      speedScale = low.speedScale + t * (high.speedScale - low.speedScale);
+      durationScale = low.durationScale + t * (high.durationScale - low.durationScale);
+      return;
+    }
+  }
+}
+
+DriveCommand governCommand(const DriveCommand& command, unsigned long ageMs) {
+  unsigned long latencyMs = max((unsigned long)averageDecisionAgeMs, ageMs);
+  float speedScale, durationScale;
+  lookupScales(latencyMs, speedScale, durationScale);
+
+  DriveCommand governed = command;
+  governed.speed = lroundf(command.speed * speedScale);
+  governed.durationMs = lroundf(command.durationMs * durationScale);
+
+  governedCommands++;
+  totalSpeedScale += speedScale;
+  totalDistanceScale += speedScale * durationScale;
+  lowestSpeedScale = min(lowestSpeedScale, speedScale);
+  if (speedScale < 1 || durationScale < 1) {
+    Serial.printf("[Governor] %lu ms behind, speed x%.2f, duration x%.2f\n", latencyMs, speedScale, durationScale);
+  }
+  return governed;
+}
+
+void printGovernorStats() {
+  Serial.printf("[Governor] Average decision age: %.0f ms\n", averageDecisionAgeMs);
+  Serial.printf("[Governor] Commands: %lu, mean speed x%.2f, lowest x%.2f, mean distance x%.2f\n", governedCommands,
+                governedCommands ? totalSpeedScale / governedCommands : 1, lowestSpeedScale,
+                governedCommands ? totalDistanceScale / governedCommands : 1);
+  for (int i = 0; i < GOVERNOR_STEPS; i++) {
+    const GovernorStep& step = GOVERNOR_TABLE[i];
+    Serial.printf("  >= %5lu ms: speed x%.2f, duration x%.2f\n", step.latencyMs, step.speedScale, step.durationScale);
+  }
+}
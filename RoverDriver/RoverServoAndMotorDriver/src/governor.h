@@ -0,0 +1,28 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <Arduino.h>
+#include "driveCommand.h"
+
+// One row of the governor table. Between rows the scales are interpolated,
+// past the last row its scales hold.
+struct GovernorStep {
+  unsigned long latencyMs;
+  float speedScale;
+  float durationScale;
+};
+
+const float DECISION_AGE_SMOOTHING = 0.3;   // weight of the newest decision in the moving average
+
+// Feeds the age of each new camera decision, from capture to arrival, into
+// the average. The poll's round trip only measures the link: the camera
+// answers from its cached decision however slow inference is.
+void noteDecisionAge(unsigned long ageMs);
+
+// Scales speed and duration by the worse of the average decision age and
+// this command's age, so the rover slows down when vision falls behind
+DriveCommand governCommand(const DriveCommand& command, unsigned long ageMs);
+
+void printGovernorStats();
+
+#endif //GOVERNOR_H
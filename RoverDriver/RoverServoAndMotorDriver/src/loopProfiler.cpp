@@ -0,0 +1,140 @@
+#include "loopProfiler.h"
+#include "power.h"
+
+const char* const SECTION_NAMES[SECTION_COUNT] = {"serial", "poll", "execute"};
+
+// The cycle counter wraps after ~17s at 240MHz, longer spans fall back to micros()
+const unsigned long CYCLE_TIMING_LIMIT_US = 10000000;
+
+struct SectionStats {
+  uint32_t startCycles;
+  unsigned long startUs;
+  uint64_t totalUs;
+  uint32_t worstUs;
+  uint32_t count;
+};
+
+uint32_t iterationStartCycles = 0;
+unsigned long iterationStartUs = 0;
+unsigned long previousPeriodUs = 0;
+
+uint32_t iterations = 0;
+uint64_t totalIterationUs = 0;
+uint64_t totalPeriodUs = 0;
+uint32_t worstIterationUs = 0;
+uint32_t worstPeriodUs = 0;
+uint32_t iterationHistogram[PROFILE_BUCKETS];
+uint32_t jitterHistogram[PROFILE_BUCKETS];
+SectionStats sections[SECTION_COUNT];
+
+uint64_t windowIterationUs = 0;
+uint32_t windowIterations = 0;
+uint32_t windowWorstUs = 0;
+
+// Idle mode scales the clock (automatically with light sleep), so cycles are
+// only trusted at full speed
+uint32_t elapsedUs(uint32_t startCycles, unsigned long startUs) {
+  unsigned long coarseUs = micros() - startUs;
+  if (isIdle() || coarseUs > CYCLE_TIMING_LIMIT_US) {
+    return coarseUs;
+  }
+  return (ESP.getCycleCount() - startCycles) / ACTIVE_CPU_MHZ;
+}
+
+int bucketFor(uint32_t us) {
+  int bucket = us ? 32 - __builtin_clz(us) : 0;
+  return min(bucket, PROFILE_BUCKETS - 1);
+}
+
+void loopProfilerBegin() {
+  unsigned long now = micros();
+  if (iterationStartUs != 0) {
+    unsigned long period = now - iterationStartUs;
+    totalPeriodUs += period;
+    worstPeriodUs = max(worstPeriodUs, (uint32_t)period);
+    if (previousPeriodUs != 0) {
+      unsigned long jitter = period > previousPeriodUs ? period - previousPeriodUs : previousPeriodUs - period;
+      jitterHistogram[bucketFor(jitter)]++;
+    }
+    previousPeriodUs = period;
+  }
+  iterationStartUs = now;
+  iterationStartCycles = ESP.getCycleCount();
+}
+
+void loopProfilerEnd() {
+  uint32_t us = elapsedUs(iterationStartCycles, iterationStartUs);
+  iterations++;
+  totalIterationUs += us;
+  worstIterationUs = max(worstIterationUs, us);
+  iterationHistogram[bucketFor(us)]++;
+
+  windowIterations++;
+  windowIterationUs += us;
+  windowWorstUs = max(windowWorstUs, us);
+}
+
+void sectionBegin(LoopSection section) {
+  sections[section].startUs = micros();
+  sections[section].startCycles = ESP.getCycleCount();
+}
+
+void sectionEnd(LoopSection section) {
+  SectionStats& stats = sections[section];
+  uint32_t us = elapsedUs(stats.startCycles, stats.startUs);
+  stats.totalUs += us;
+  stats.worstUs = max(stats.worstUs, us);
+  stats.count++;
+}
+
+void loopProfilerWindow(unsigned long& meanUs, unsigned long& maxUs) {
+  meanUs = windowIterations ? windowIterationUs / windowIterations : 0;
+  maxUs = windowWorstUs;
+  windowIterationUs = 0;
+  windowIterations = 0;
+  windowWorstUs = 0;
+}
+
+void printHistogram(const char* name, const uint32_t* histogram) {
+  Serial.printf("[Profile] %s histogram (us):\n", name);
+  for (int i = 0; i < PROFILE_BUCKETS; i++) {
+    if (histogram[i] == 0) {
+      continue;
+    }
+    unsigned long low = i ? 1UL << (i - 1) : 0;
+    if (i == PROFILE_BUCKETS - 1) {
+      Serial.printf("  >= %lu: %lu\n", low, (unsigned long)histogram[i]);
+    } else {
+      Serial.printf("  %lu-%lu: %lu\n", low, (1UL << i) - 1, (unsigned long)histogram[i]);
+    }
+  }
+}
+
+void printLoopProfile() {
+  uint32_t periods = iterations > 1 ? iterations - 1 : 0;
+  Serial.printf("[Profile] Iterations: %lu, mean %lu us, worst %lu us\n", (unsigned long)iterations,
+                (unsigned long)(iterations ? totalIterationUs / iterations : 0), (unsigned long)worstIterationUs);
+  Serial.printf("[Profile] Loop period mean %lu us, worst %lu us\n",
+                (unsigned long)(periods ? totalPeriodUs / periods : 0), (unsigned long)worstPeriodUs);
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    const SectionStats& stats = sections[i];
+    Serial.printf("  %-8s x%lu, mean %lu us, worst %lu us\n", SECTION_NAMES[i], (unsigned long)stats.count,
+                  (unsigned long)(stats.count ? stats.totalUs / stats.count : 0), (unsigned long)stats.worstUs);
+  }
+  printHistogram("Iteration", iterationHistogram);
+  printHistogram("Period jitter", jitterHistogram);
+}
+
+void resetLoopProfile() {
+  iterationStartUs = 0;
+  previousPeriodUs = 0;
+  iterations = 0;
+  totalIterationUs = 0;
+  totalPeriodUs = 0;
+  worstIterationUs = 0;
+  worstPeriodUs = 0;
+  memset(iterationHistogram, 0, sizeof(iterationHistogram));
+  memset(jitterHistogram, 0, sizeof(jitterHistogram));
+  memset(sections, 0, sizeof(sections));
+  Serial.println("[Profile] Reset");
+}
@@ -0,0 +1,35 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Cheap enough to leave on: a few cycle counter reads and adds per loop.
+// Iteration time is the work between loopProfilerBegin() and loopProfilerEnd()
+// and excludes the idle sleep; period is begin to begin.
+const int PROFILE_BUCKETS = 20;   // log2 buckets in microseconds, last one is open ended
+
+enum LoopSection : uint8_t {
+  SECTION_SERIAL,
+  SECTION_POLL,
+  SECTION_EXECUTE,
+  SECTION_COUNT
+};
+
+void loopProfilerBegin();
+void loopProfilerEnd();
+
+// Brackets a part of the loop to see how much of the iteration it takes
+void sectionBegin(LoopSection section);
+void sectionEnd(LoopSection section);
+
+// Mean and worst iteration time since the previous call, for telemetry
+void loopProfilerWindow(unsigned long& meanUs, unsigned long& maxUs);
+
+// Time since a cycle count / micros() pair was taken, in microseconds. Uses
+// the cycle counter at full clock and micros() otherwise.
+uint32_t elapsedUs(uint32_t startCycles, unsigned long startUs);
+
+void printLoopProfile();
+void resetLoopProfile();
+
+#endif //LOOP_PROFILER_H
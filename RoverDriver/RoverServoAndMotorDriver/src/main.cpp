@@ -1,83 +1,120 @@
-#include <ESP32Servo.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include "secrets.h"
-
-//SERVO SETUP
-Servo frontLeftServo;
-Servo frontRightServo;
-Servo backLeftServo;
-Servo backRightServo;
-
-const int SERVO_FRONT_LEFT_PIN = 16;
-const int SERVO_FRONT_RIGHT_PIN = 17;
-const int SERVO_BACK_LEFT_PIN = 18;
-const int SERVO_BACK_RIGHT_PIN = 19;
-
-// L298N MOTOR SETUP
-const int F_MOTOR_LEFT_IN1 = 2;   // F-Left motor control pin 1
-const int F_MOTOR_LEFT_IN2 = 4;   // F-Left motor control pin 2
-const int F_MOTOR_RIGHT_IN3 = 5;  // F-Right motor control pin 1
-const int F_MOTOR_RIGHT_IN4 = 13; // F-Right motor control pin 2
-
-const int M_MOTOR_LEFT_IN1 = 14;   // M-Left motor control pin 1
-const int M_MOTOR_LEFT_IN2 = 12;   // M-Left motor control pin 2
-const int M_MOTOR_RIGHT_IN3 = 15;  // M-Right motor control pin 1
-const int M_MOTOR_RIGHT_IN4 = 27; // M-Right motor control pin 2
-
-const int B_MOTOR_LEFT_IN1 = 26;   // B-Left motor control pin 1
-const int B_MOTOR_LEFT_IN2 = 25;   // B-Left motor control pin 2
-const int B_MOTOR_RIGHT_IN3 = 33;  // B-Right motor control pin 1
-const int B_MOTOR_RIGHT_IN4 = 32; // B-Right motor control pin 2
+#include "drive.h"
+#include "odometry.h"
+#include "safety.h"
+#include "power.h"
+#include "roverState.h"
+#include "commandTransport.h"
+#include "uartTransport.h"
+#include "telemetry.h"
+#include "loopProfiler.h"
+#include "commandAge.h"
+#include "governor.h"
+#include "occupancyGrid.h"
+#include "planner.h"
+#include "actuatorTiming.h"
+#include "flightRecorder.h"
+
+// RANGE SENSOR SETUP
+const int ULTRASONIC_TRIG_PIN = 23;
+const int ULTRASONIC_ECHO_PIN = 34;
+
+// Uncomment to bench test the safety layer without a sensor fitted
+// #define SIMULATED_RANGE_SENSOR
+
+#ifdef SIMULATED_RANGE_SENSOR
+SimulatedRangeSensor rangeSensor;
+#else
+UltrasonicRangeSensor rangeSensor(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN);
+#endif
+
+// UART LINK SETUP
+const int UART_LINK_RX_PIN = 35;
+const int UART_LINK_TX_PIN = 21;
+
+// Uncomment one to poll the camera over UDP datagrams or the wired UART link instead of HTTP
+// #define UDP_COMMAND_TRANSPORT
+// #define UART_COMMAND_TRANSPORT
+
+#if defined(UART_COMMAND_TRANSPORT)
+UartCommandTransport commandTransport(Serial2, UART_LINK_RX_PIN, UART_LINK_TX_PIN);
+// The wired link works without WiFi, which then only joins in the background
+const bool COMMANDS_NEED_WIFI = false;
+#elif defined(UDP_COMMAND_TRANSPORT)
+UdpCommandTransport commandTransport(serverEndpoint, COMMAND_UDP_PORT);
+const bool COMMANDS_NEED_WIFI = true;
+#else
+HttpCommandTransport commandTransport(serverEndpoint);
+const bool COMMANDS_NEED_WIFI = true;
+#endif
+
+// Uncomment to choose maneuvers on the rover from the occupancy grid. Vision
+// then only feeds the grid and its commands are not executed.
+// #define LOCAL_PLANNER
 
 // CONSTANTS
-const int CENTER_ANGLE = 90;
-const int RIGHT_ANGLE = 120;
-const int LEFT_ANGLE = 60; 
-const int RETURN_DELAY = 500; 
-const int MOVEMENT_DELAY = 2000;
 const int HTTP_REQUEST_INTERVAL = 3000; 
 
 
 //Global Vars
+RoverStateMachine rover;
 String lastCommand = "FULL_STOP";
+DriveCommand activeCommand = STOP_PRESET;
 unsigned long movementStartTime = 0;
-bool isMoving = false;
+unsigned long engageMotorsTime = 0;
+bool motorsEngaged = false;
+unsigned long stopStartTime = 0;
+unsigned long stopDuration = 0;
 
 unsigned long lastRequestTime = 0; 
+uint16_t lastFusedDecisionSeq = 0;   // camera decision whose obstacles are in the grid
+uint16_t lastAgedDecisionSeq = 0;    // camera decision last fed to the governor
 
-String retrieveCommandFromCamera() {
-  HTTPClient http;
-  String serverPath = String(serverEndpoint) + "?lastCommand=" + lastCommand;
-
-  http.begin(serverPath.c_str());
-
-  int httpResponseCode = http.GET();
-  String command = "STOP";
-
-  if (httpResponseCode > 0) {
-    Serial.print("HTTP Response code: ");
-    Serial.println(httpResponseCode);
-    String payload = http.getString();
-    Serial.println("Response: " + payload);
+float maneuverProgress() {
+  RoverMode mode = rover.mode();
+  if (mode != RoverMode::Moving && mode != RoverMode::Turning) {
+    return 1;
+  }
+  if (!motorsEngaged) {
+    return 0;
+  }
+  long drivenMs = max((long)(millis() - movementStartTime), 0L);
+  return activeCommand.durationMs ? (float)drivenMs / activeCommand.durationMs : 1;
+}
 
-    if (payload.length() > 0) {
-      command = payload;
-    }
-  } else {
-    Serial.print("Error code: ");
-    Serial.println(httpResponseCode);
+CommandMessage retrieveCommandFromCamera() {
+  RoverTelemetry telemetry = collectTelemetry((uint8_t)rover.mode(), maneuverProgress());
+  CommandMessage message;
+  unsigned long requestStart = millis();
+  bool received = commandTransport.fetchCommand(lastCommand, telemetry, message);
+  recordFlightEvent(FLIGHT_POLL, received, millis() - requestStart);
+  if (!received) {
     Serial.println("Failed to get command, using STOP");
+    message.command = "STOP";
+    message.hasObstacleReport = false;
+    message.decisionSeq = 0;
+    stampCommandMessage(message, false, 0, 0);
+    return message;
   }
-
-  http.end();
-  return command;
+  // The camera serves the same decision to several polls, its age and evidence only count once
+  if (message.decisionSeq == 0 || message.decisionSeq != lastAgedDecisionSeq) {
+    lastAgedDecisionSeq = message.decisionSeq;
+    noteDecisionAge(millis() - message.capturedAtMs);
+  }
+  if (message.hasObstacleReport && message.decisionSeq != 0 && message.decisionSeq != lastFusedDecisionSeq) {
+    lastFusedDecisionSeq = message.decisionSeq;
+    addVisionEvidence(message.obstacles);
+    requestPlan();
+  }
+  return message;
 }
 
 void connectToWiFi() {
   Serial.println("Connecting...");
   WiFi.begin(ssid, password);
-  WiFi.setSleep(false);
+  // A reconnect can happen while parked, keep the radio in the power mode's sleep state
+  WiFi.setSleep(isIdle());
 
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
@@ -85,198 +122,318 @@ void connectToWiFi() {
   }
   Serial.println("");
   Serial.println("WiFi connected");
+  recordFlightEvent(FLIGHT_WIFI, 1, WiFi.RSSI());
+  commandTransport.begin();
 }
 
-void stopMotors() {
-  digitalWrite(F_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(F_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(F_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(F_MOTOR_RIGHT_IN4, LOW);
-
-  digitalWrite(M_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(M_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(M_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(M_MOTOR_RIGHT_IN4, LOW);
-
-  digitalWrite(B_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(B_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(B_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(B_MOTOR_RIGHT_IN4, LOW);
+RoverEvent commandEvent(const DriveCommand& command) {
+  if (isStopCommand(command)) {
+    return RoverEvent::StopCommand;
+  }
+  return command.curvature != 0 ? RoverEvent::TurnCommand : RoverEvent::DriveCommand;
 }
 
-void motorsForward() {
-  Serial.println("Moving Forward");
-  // Front motors
-  digitalWrite(F_MOTOR_LEFT_IN1, HIGH);
-  digitalWrite(F_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(F_MOTOR_RIGHT_IN3, HIGH);
-  digitalWrite(F_MOTOR_RIGHT_IN4, LOW);
-
-  // Middle motors
-  digitalWrite(M_MOTOR_LEFT_IN1, HIGH);
-  digitalWrite(M_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(M_MOTOR_RIGHT_IN3, HIGH);
-  digitalWrite(M_MOTOR_RIGHT_IN4, LOW);
-
-  // Back motors
-  digitalWrite(B_MOTOR_LEFT_IN1, HIGH);
-  digitalWrite(B_MOTOR_LEFT_IN2, LOW);
-  digitalWrite(B_MOTOR_RIGHT_IN3, HIGH);
-  digitalWrite(B_MOTOR_RIGHT_IN4, LOW);
+// Entry actions for the mode the state machine just moved into
+void onModeEntered(RoverMode mode) {
+  switch (mode) {
+    case RoverMode::Moving:
+    case RoverMode::Turning: {
+      // Steer first, the motors start once the servos have settled
+      int fromAngle = steeringAngle();
+      setSteering(activeCommand.curvature);
+      motorsEngaged = false;
+      engageMotorsTime = millis() + servoSettleMs(fromAngle, steeringAngle());
+      break;
+    }
+    case RoverMode::Stopping:
+      stopStartTime = millis();
+      stopDuration = max(motorSpinDownMs(), servoSettleMs(steeringAngle(), CENTER_ANGLE));
+      stopMotors();
+      centerWheels();
+      Serial.println("Stopping Rover...");
+      break;
+    case RoverMode::Failsafe:
+      stopMotors();
+      centerWheels();
+      lastCommand = "FULL_STOP";
+      break;
+    default:
+      break;
+  }
 }
 
-void motorsBackwards() {
-  Serial.println("Moving Backward");
-  // Front motors
-  digitalWrite(F_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(F_MOTOR_LEFT_IN2, HIGH);
-  digitalWrite(F_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(F_MOTOR_RIGHT_IN4, HIGH);
-
-  // Middle motors
-  digitalWrite(M_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(M_MOTOR_LEFT_IN2, HIGH);
-  digitalWrite(M_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(M_MOTOR_RIGHT_IN4, HIGH);
-
-  // Back motors
-  digitalWrite(B_MOTOR_LEFT_IN1, LOW);
-  digitalWrite(B_MOTOR_LEFT_IN2, HIGH);
-  digitalWrite(B_MOTOR_RIGHT_IN3, LOW);
-  digitalWrite(B_MOTOR_RIGHT_IN4, HIGH);
+void handleEvent(RoverEvent event) {
+  if (rover.dispatch(event)) {
+    onModeEntered(rover.mode());
+  }
 }
 
-void centerWheels() {
-  Serial.println("Centering");
-  frontLeftServo.write(CENTER_ANGLE);
-  frontRightServo.write(CENTER_ANGLE);
-  backLeftServo.write(CENTER_ANGLE);
-  backRightServo.write(CENTER_ANGLE);
+// Expired commands are downgraded to STOP, late ones only run until their
+// deadline. The motors start once steering has settled and the maneuver is
+// timed from when they reach speed, so both waits come out of the remaining
+// time too.
+CommandFreshness applyDeadline(const CommandMessage& message, DriveCommand& driveCommand) {
+  unsigned long now = millis();
+  unsigned long settleMs =
+      servoSettleMs(steeringAngle(), steeringAngleFor(driveCommand.curvature)) + motorSpinUpMs();
+  if ((long)(now + settleMs - message.deadlineMs) >= 0) {
+    Serial.println("Command " + message.command + " expired, stopping instead");
+    driveCommand = STOP_PRESET;
+    return COMMAND_EXPIRED;
+  }
+  unsigned long remainingMs = message.deadlineMs - now - settleMs;
+  if (driveCommand.durationMs > remainingMs) {
+    driveCommand.durationMs = remainingMs;
+    return COMMAND_TRUNCATED;
+  }
+  return COMMAND_FRESH;
 }
 
-void leftTurn() {
-  Serial.println("Turning left");
-  frontLeftServo.write(LEFT_ANGLE);
-  frontRightServo.write(LEFT_ANGLE);
-  backLeftServo.write(LEFT_ANGLE);
-  backRightServo.write(LEFT_ANGLE);
+void executeCommand(const CommandMessage& message) {
+  String command = message.command;
+  DriveCommand driveCommand;
+  if (!parseDriveCommand(command, driveCommand)) {
+    Serial.println("Unknown command " + command + ", stopping");
+    driveCommand = STOP_PRESET;
+  }
+  unsigned long ageMs = millis() - message.capturedAtMs;
+  CommandFreshness freshness = COMMAND_FRESH;
+  if (!isStopCommand(driveCommand)) {
+    freshness = applyDeadline(message, driveCommand);
+    recordCommandAge(ageMs, freshness);
+    if (freshness != COMMAND_EXPIRED) {
+      driveCommand = governCommand(driveCommand, ageMs);
+    }
+  }
+  if (driveCommand.speed > 0 && safetyBlocksForward()) {
+    Serial.println("[Safety] Obstacle ahead, overriding " + command + " with STOP");
+    driveCommand = STOP_PRESET;
+  }
+  // curvature, speed and duration packed as bytes 3, 2 and the low half
+  recordFlightEvent(FLIGHT_COMMAND, freshness,
+                    ((uint32_t)(uint8_t)driveCommand.curvature << 24) |
+                        ((uint32_t)(uint8_t)driveCommand.speed << 16) | driveCommand.durationMs,
+                    ageMs);
+
+  RoverEvent event = commandEvent(driveCommand);
+  if (!isLegalTransition(rover.mode(), event)) {
+    Serial.println("Vehicle is currently " + String(roverModeName(rover.mode())) + " " + lastCommand);
+    return;
+  }
+
+  if (event == RoverEvent::StopCommand) {
+    lastCommand = "FULL_STOP";
+  } else {
+    lastCommand = command;
+    activeCommand = driveCommand;
+  }
+  recordCommandEnergy(driveCommand);
+  noteCommandExecuted();
+  handleEvent(event);
+  Serial.print("Executing command: ");
+  Serial.println(command);
 }
 
-void rightTurn() {
-  Serial.println("Turning right");
-  frontLeftServo.write(RIGHT_ANGLE);
-  frontRightServo.write(RIGHT_ANGLE);
-  backLeftServo.write(RIGHT_ANGLE);
-  backRightServo.write(RIGHT_ANGLE);
+// The planner's choice goes through the same checks as a camera command
+CommandMessage plannedCommandMessage(const DriveCommand& planned) {
+  CommandMessage message;
+  message.command = encodeDriveCommand(planned);
+  message.hasObstacleReport = false;
+  message.decisionSeq = 0;
+  stampCommandMessage(message, true, 0, DEFAULT_COMMAND_VALIDITY_MS);
+  return message;
 }
 
-void executeCommand(String command) {
-  if (command == "STOP" || command == "FULL_STOP") {
-    stopMotors();
-    centerWheels();
-    isMoving = false;
-    lastCommand = "FULL_STOP";
-    Serial.println("Stopping Rover...");
-    return;
-  }
-  if (!isMoving) {
-    lastCommand = command;
-    if (command == "TURN_LEFT"){ 
-      isMoving = true;
-      leftTurn();
-      motorsForward();
-      centerWheels();
-    } else if (command == "TURN_RIGHT"){
-      isMoving = true;
-      rightTurn();
-      motorsForward();
-      centerWheels();
-    } else if (command =="FORWARD") {
-      isMoving = true;
-      motorsForward();
-    } else if (command == "BACKWARD"){
-      isMoving = true;
-      motorsBackwards();
-    } else {
-      isMoving = false;
-      centerWheels();
-      stopMotors();
+// Engages the motors once steering has settled. The maneuver's duration is
+// timed from when they are up to speed, so short maneuvers cover their
+// distance. The path may have closed while the servos settled, so a forward
+// maneuver is dropped rather than started into an obstacle.
+bool maneuverDone() {
+  unsigned long now = millis();
+  if (!motorsEngaged) {
+    if (activeCommand.speed > 0 && safetyBlocksForward()) {
+      Serial.println("[Safety] Obstacle ahead, not engaging the motors");
+      return true;
     }
-    Serial.print("Executing command: ");
-    Serial.println(command);
-  } else {
-    Serial.println("Vehicle is currently moveing" + lastCommand);
+    if ((long)(now - engageMotorsTime) >= 0) {
+      applyDrive(activeCommand);
+      motorsEngaged = true;
+      movementStartTime = now + motorSpinUpMs();
+    }
+    return false;
+  }
+  return (long)(now - movementStartTime) >= (long)activeCommand.durationMs;
+}
+
+// Time driven transitions. Each case knows its mode, so fire<>() checks the
+// transition at compile time.
+void updateMode() {
+  switch (rover.mode()) {
+    case RoverMode::Moving:
+      if (maneuverDone()) {
+        rover.fire<RoverMode::Moving, RoverEvent::ManeuverDone>();
+        onModeEntered(rover.mode());
+      }
+      break;
+    case RoverMode::Turning:
+      if (maneuverDone()) {
+        rover.fire<RoverMode::Turning, RoverEvent::ManeuverDone>();
+        onModeEntered(rover.mode());
+      }
+      break;
+    case RoverMode::Stopping:
+      if (millis() - stopStartTime >= stopDuration) {
+        rover.fire<RoverMode::Stopping, RoverEvent::Settled>();
+        Serial.println("Finished Command: " + lastCommand);
+        requestPlan();
+      }
+      break;
+    case RoverMode::Failsafe:
+      // An obstacle that is still there only keeps forward motion off, through
+      // the drive's forward inhibit; reversing and turning away stay possible
+      if (safetyAllowsRecovery() && (!COMMANDS_NEED_WIFI || WiFi.status() == WL_CONNECTED)) {
+        rover.fire<RoverMode::Failsafe, RoverEvent::Recover>();
+        Serial.println("[State] Recovered from failsafe");
+        requestPlan();
+      }
+      break;
+    default:
+      break;
   }
 }
 
 void setup() {
   Serial.begin(9600);
   Serial.println("Initialization...");
+  setupFlightRecorder();
   
-  // SERVO TIMERS
-  ESP32PWM::allocateTimer(0);
-  ESP32PWM::allocateTimer(1);
-  ESP32PWM::allocateTimer(2);
-  ESP32PWM::allocateTimer(3);
-  
-  // SERVO FREQUENCIES
-  frontLeftServo.setPeriodHertz(50);
-  frontRightServo.setPeriodHertz(50);
-  backLeftServo.setPeriodHertz(50);
-  backRightServo.setPeriodHertz(50);
-  
-  // SERVO ATTACHMENTS
-  frontLeftServo.attach(SERVO_FRONT_LEFT_PIN, 500, 2500);
-  frontRightServo.attach(SERVO_FRONT_RIGHT_PIN, 500, 2500);
-  backLeftServo.attach(SERVO_BACK_LEFT_PIN, 500, 2500);
-  backRightServo.attach(SERVO_BACK_RIGHT_PIN, 500, 2500);
-  
-  Serial.println("Servos initialized");
-  
-  // MOTOR PINMODES
-  pinMode(F_MOTOR_LEFT_IN1, OUTPUT);
-  pinMode(F_MOTOR_LEFT_IN2, OUTPUT);
-  pinMode(F_MOTOR_RIGHT_IN3, OUTPUT);
-  pinMode(F_MOTOR_RIGHT_IN4, OUTPUT);
-
-  pinMode(M_MOTOR_LEFT_IN1, OUTPUT);
-  pinMode(M_MOTOR_LEFT_IN2, OUTPUT);
-  pinMode(M_MOTOR_RIGHT_IN3, OUTPUT);
-  pinMode(M_MOTOR_RIGHT_IN4, OUTPUT);
-
-  pinMode(B_MOTOR_LEFT_IN1, OUTPUT);
-  pinMode(B_MOTOR_LEFT_IN2, OUTPUT);
-  pinMode(B_MOTOR_RIGHT_IN3, OUTPUT);
-  pinMode(B_MOTOR_RIGHT_IN4, OUTPUT);
-  
-  stopMotors();
+  setupDrive();
+  setupSafety(&rangeSensor);
+  setupPower();
+  setupOccupancyGrid(&rangeSensor);
+  setupActuatorTiming();
+
+  if (!COMMANDS_NEED_WIFI) {
+    commandTransport.begin();
+    WiFi.begin(ssid, password);
+  }
+}
+
+void processSerialCommands() {
+  if (!Serial.available()) {
+    return;
+  }
+  String input = Serial.readStringUntil('\n');
+  input.trim();
+
+  if (input == "safety") {
+    printSafetyReport();
+  } else if (input == "power") {
+    printPowerReport();
+  } else if (input == "state") {
+    rover.printProfile();
+  } else if (input == "prof") {
+    printLoopProfile();
+  } else if (input == "prof reset") {
+    resetLoopProfile();
+  } else if (input == "age") {
+    printCommandAgeStats();
+  } else if (input == "gov") {
+    printGovernorStats();
+  } else if (input == "grid") {
+    printOccupancyGrid();
+  } else if (input == "grid clear") {
+    clearOccupancyGrid();
+  } else if (input == "plan") {
+    printPlannerStats();
+  } else if (input == "plan bench") {
+    benchmarkPlanner(PLANNER_BENCH_RUNS);
+  } else if (input == "timing") {
+    printActuatorTiming();
+  } else if (input == "calibrate") {
+    if (rover.mode() != RoverMode::Idle) {
+      Serial.println("[Actuator] Only calibrating while idle");
+    } else if (characterizeActuators()) {
+      // The wheels spun in the air, none of that was real motion
+      resetOdometry();
+      clearOccupancyGrid();
+    }
+  } else if (input == "rec") {
+    printFlightRecorderStats();
+  } else if (input == "rec erase") {
+    eraseFlightRecorder();
+  } else if (input == "link") {
+    Serial.printf("[Link] Transport: %s\n", commandTransport.name());
+    commandTransport.printStats();
+#if defined(UDP_COMMAND_TRANSPORT) || defined(UART_COMMAND_TRANSPORT)
+  } else if (input.startsWith("loss ")) {
+    commandTransport.setInjectedLoss(input.substring(5).toInt());
+#endif
+#ifdef SIMULATED_RANGE_SENSOR
+  } else if (input.startsWith("sim ")) {
+    rangeSensor.setDistance(input.substring(4).toFloat());
+    Serial.println("[Safety] Simulated obstacle at " + input.substring(4) + " cm");
+#endif
+  }
 }
 
 void loop() {
-  if (WiFi.status() != WL_CONNECTED) {
+  loopProfilerBegin();
+  sectionBegin(SECTION_SERIAL);
+  processSerialCommands();
+  sectionEnd(SECTION_SERIAL);
+  updateEnergy();
+  updateOccupancyGrid();
+
+  if (safetyTripped()) {
+    handleEvent(RoverEvent::Fault);
+    Serial.println("[Safety] Obstacle too close, motion cut");
+  }
+
+  if (COMMANDS_NEED_WIFI && WiFi.status() != WL_CONNECTED) {
     Serial.println("WiFi disconnected. Reconnecting...");
+    recordFlightEvent(FLIGHT_WIFI, 0);
+    handleEvent(RoverEvent::Fault);
     connectToWiFi();
   }
 
   unsigned long time = millis();
   if (time - lastRequestTime >= HTTP_REQUEST_INTERVAL) {
     lastRequestTime = time;
-    String newCommand = retrieveCommandFromCamera();
-    Serial.println("Received command: " + newCommand);
+    sectionBegin(SECTION_POLL);
+    CommandMessage newCommand = retrieveCommandFromCamera();
+    sectionEnd(SECTION_POLL);
+    Serial.println("Received command: " + newCommand.command);
+#ifndef LOCAL_PLANNER
+    sectionBegin(SECTION_EXECUTE);
     executeCommand(newCommand);
+    sectionEnd(SECTION_EXECUTE);
+#endif
   }
 
-  if(isMoving) {
-    if(time - movementStartTime >= MOVEMENT_DELAY) {
-      if (lastCommand == "TURN_LEFT" || lastCommand == "TURN_RIGHT") {
-        
-        centerWheels();
-        stopMotors();
-      } else {
-        stopMotors();
-      }
-      isMoving = false;
-      Serial.println("Finished Command: " + lastCommand);
-    }
+#ifdef LOCAL_PLANNER
+  DriveCommand planned;
+  if (rover.mode() == RoverMode::Idle && planStep(planned) && !isStopCommand(planned)) {
+    sectionBegin(SECTION_EXECUTE);
+    executeCommand(plannedCommandMessage(planned));
+    sectionEnd(SECTION_EXECUTE);
+  }
+#endif
+
+  updateMode();
+  loopProfilerEnd();
+
+  bool parked = rover.mode() == RoverMode::Idle || rover.mode() == RoverMode::Failsafe;
+#ifdef LOCAL_PLANNER
+  // Keep running loop() while a plan is being worked through
+  parked = parked && !(rover.mode() == RoverMode::Idle && planPending());
+#endif
+
+  // Parked: sleep through the gap until the next poll instead of spinning
+  if (parked) {
+    enterIdle();
+    idleUntil(lastRequestTime + HTTP_REQUEST_INTERVAL);
+  } else {
+    exitIdle();
   }
 }
\ No newline at end of file
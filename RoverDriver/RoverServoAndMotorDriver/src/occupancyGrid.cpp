@@ -0,0 +1,214 @@
+#include "occupancyGrid.h"
+#include "odometry.h"
+
+RangeSensor* gridRangeSensor = nullptr;
+
+// Only touched from the loop task
+int8_t grid[GRID_CELLS][GRID_CELLS];   // [row][col]
+int8_t shifted[GRID_CELLS][GRID_CELLS];
+Pose gridPose = {0, 0, 0};             // pose the grid's frame is anchored to
+unsigned long lastRangeSampleUs = 0;
+unsigned long lastRangeEvidenceMs = 0;
+unsigned long lastDecayMs = 0;
+
+unsigned long visionReports = 0;
+unsigned long rangeSamples = 0;
+unsigned long gridShifts = 0;
+
+bool cellInGrid(int col, int row) {
+  return col >= 0 && col < GRID_CELLS && row >= 0 && row < GRID_CELLS;
+}
+
+void addEvidence(int col, int row, int8_t evidence) {
+  if (!cellInGrid(col, row)) {
+    return;
+  }
+  grid[row][col] = constrain(grid[row][col] + evidence, -GRID_MAX_EVIDENCE, GRID_MAX_EVIDENCE);
+}
+
+// Free evidence along a ray from the rover, and a hit at its end if hit is set.
+// Each cell is counted once however many steps fall in it.
+void traceRay(float bearingDeg, float distanceCm, bool hit, int8_t freeEvidence, int8_t hitEvidence) {
+  float bearing = radians(bearingDeg);
+  float dx = sinf(bearing);
+  float dy = cosf(bearing);
+  int endCol = gridIndex(distanceCm * dx);
+  int endRow = gridIndex(distanceCm * dy);
+  int lastCol = GRID_HALF;
+  int lastRow = GRID_HALF;
+
+  for (float r = GRID_CELL_CM / 2; r < distanceCm; r += GRID_CELL_CM / 2) {
+    int col = gridIndex(r * dx);
+    int row = gridIndex(r * dy);
+    if (!cellInGrid(col, row)) {
+      return;
+    }
+    if ((col == lastCol && row == lastRow) || (hit && col == endCol && row == endRow)) {
+      continue;
+    }
+    addEvidence(col, row, freeEvidence);
+    lastCol = col;
+    lastRow = row;
+  }
+  if (hit) {
+    addEvidence(endCol, endRow, hitEvidence);
+  }
+}
+
+// Re-projects every cell from the frame of gridPose into the frame of pose
+void shiftGrid(const Pose& pose) {
+  float newSin = sinf(pose.headingRad);
+  float newCos = cosf(pose.headingRad);
+  float oldSin = sinf(gridPose.headingRad);
+  float oldCos = cosf(gridPose.headingRad);
+
+  for (int row = 0; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      float right = (col - GRID_HALF) * GRID_CELL_CM;
+      float forward = (row - GRID_HALF) * GRID_CELL_CM;
+      // Rover frame to world, right is (cos, -sin) and forward (sin, cos)
+      float dx = pose.xCm + right * newCos + forward * newSin - gridPose.xCm;
+      float dy = pose.yCm - right * newSin + forward * newCos - gridPose.yCm;
+      int oldCol = gridIndex(dx * oldCos - dy * oldSin);
+      int oldRow = gridIndex(dx * oldSin + dy * oldCos);
+      shifted[row][col] = cellInGrid(oldCol, oldRow) ? grid[oldRow][oldCol] : 0;
+    }
+  }
+  memcpy(grid, shifted, sizeof(grid));
+  gridPose = pose;
+  gridShifts++;
+}
+
+void decayGrid() {
+  for (int row = 0; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      if (grid[row][col] > 0) {
+        grid[row][col]--;
+      } else if (grid[row][col] < 0) {
+        grid[row][col]++;
+      }
+    }
+  }
+}
+
+void addRangeEvidence() {
+  unsigned long sampleUs = gridRangeSensor->sampleTimeUs();
+  if (sampleUs == lastRangeSampleUs) {
+    return;
+  }
+  lastRangeSampleUs = sampleUs;
+  lastRangeEvidenceMs = millis();
+  rangeSamples++;
+
+  float distance = gridRangeSensor->distanceCm();
+  if (distance < 0 || distance > RANGE_SENSOR_MAX_CM) {
+    traceRay(0, RANGE_SENSOR_MAX_CM, false, RANGE_FREE_EVIDENCE, 0);
+  } else {
+    traceRay(0, distance, true, RANGE_FREE_EVIDENCE, RANGE_HIT_EVIDENCE);
+  }
+}
+
+void setupOccupancyGrid(RangeSensor* sensor) {
+  gridRangeSensor = sensor;
+  clearOccupancyGrid();
+}
+
+void updateOccupancyGrid() {
+  Pose pose = currentPose();
+  float moved = hypotf(pose.xCm - gridPose.xCm, pose.yCm - gridPose.yCm);
+  if (moved >= GRID_CELL_CM || fabsf(pose.headingRad - gridPose.headingRad) >= GRID_SHIFT_HEADING_RAD) {
+    shiftGrid(pose);
+  }
+
+  unsigned long now = millis();
+  if (gridRangeSensor && now - lastRangeEvidenceMs >= RANGE_EVIDENCE_INTERVAL_MS) {
+    addRangeEvidence();
+  }
+  if (now - lastDecayMs >= GRID_DECAY_INTERVAL_MS) {
+    lastDecayMs = now;
+    decayGrid();
+  }
+}
+
+// Hits across the width of a sector, each cell counted once
+void markSectorHit(ObstacleSector sector, ObstacleRange range) {
+  int lastCol = -1;
+  int lastRow = -1;
+  for (float offset = -SECTOR_HALF_WIDTH_DEG; offset <= SECTOR_HALF_WIDTH_DEG; offset += SECTOR_HALF_WIDTH_DEG) {
+    float bearing = radians(SECTOR_BEARING_DEG[sector] + offset);
+    int col = gridIndex(RANGE_DISTANCE_CM[range] * sinf(bearing));
+    int row = gridIndex(RANGE_DISTANCE_CM[range] * cosf(bearing));
+    if (col != lastCol || row != lastRow) {
+      addEvidence(col, row, VISION_HIT_EVIDENCE);
+    }
+    lastCol = col;
+    lastRow = row;
+  }
+}
+
+// Each sector is cleared up to its nearest reported obstacle, or to FAR if
+// none. Further obstacles in a sector still count as hits.
+void addVisionEvidence(const ObstacleReport& report) {
+  updateOccupancyGrid();
+  visionReports++;
+
+  int nearest[SECTOR_COUNT] = {RANGE_COUNT, RANGE_COUNT, RANGE_COUNT};
+  for (int i = 0; i < report.count; i++) {
+    ObstacleSector sector = obstacleSector(report.obstacles[i]);
+    ObstacleRange range = obstacleRange(report.obstacles[i]);
+    if (sector >= SECTOR_COUNT || range >= RANGE_COUNT) {
+      continue;
+    }
+    nearest[sector] = min(nearest[sector], (int)range);
+    markSectorHit(sector, range);
+  }
+
+  for (int sector = 0; sector < SECTOR_COUNT; sector++) {
+    bool hit = nearest[sector] < RANGE_COUNT;
+    // Stop short of the obstacle's own cell
+    float distance = hit ? RANGE_DISTANCE_CM[nearest[sector]] - GRID_CELL_CM : RANGE_DISTANCE_CM[RANGE_FAR];
+    for (float offset = -SECTOR_HALF_WIDTH_DEG; offset <= SECTOR_HALF_WIDTH_DEG; offset += SECTOR_HALF_WIDTH_DEG) {
+      traceRay(SECTOR_BEARING_DEG[sector] + offset, distance, false, VISION_FREE_EVIDENCE, 0);
+    }
+  }
+}
+
+int8_t cellEvidence(int col, int row) {
+  return cellInGrid(col, row) ? grid[row][col] : 0;
+}
+
+bool cellOccupied(int col, int row) {
+  return cellEvidence(col, row) >= GRID_OCCUPIED_EVIDENCE;
+}
+
+bool occupiedAt(float xCm, float yCm) {
+  return cellOccupied(gridIndex(xCm), gridIndex(yCm));
+}
+
+void clearOccupancyGrid() {
+  memset(grid, 0, sizeof(grid));
+  gridPose = currentPose();
+}
+
+// Forward is up, '^' is the rover, '#' occupied, '.' free, ' ' unknown
+void printOccupancyGrid() {
+  Serial.printf("[Grid] %d x %d cells of %.0f cm, %lu vision reports, %lu range samples, %lu shifts\n", GRID_CELLS,
+                GRID_CELLS, GRID_CELL_CM, visionReports, rangeSamples, gridShifts);
+  char line[GRID_CELLS + 1];
+  line[GRID_CELLS] = '\0';
+  for (int row = GRID_CELLS - 1; row >= 0; row--) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      int8_t evidence = grid[row][col];
+      if (col == GRID_HALF && row == GRID_HALF) {
+        line[col] = '^';
+      } else if (evidence >= GRID_OCCUPIED_EVIDENCE) {
+        line[col] = '#';
+      } else if (evidence < 0) {
+        line[col] = '.';
+      } else {
+        line[col] = ' ';
+      }
+    }
+    Serial.printf("[Grid] |%s|\n", line);
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <Arduino.h>
+#include "commandPacket.h"
+#include "rangeSensor.h"
+
+// Square grid centred on the rover, in the rover frame: x to the right, y forward.
+// It is re-projected as odometry reports motion, so evidence follows the world.
+const int GRID_CELLS = 21;
+const int GRID_HALF = GRID_CELLS / 2;
+const float GRID_CELL_CM = 10;
+
+// Cells hold clamped log-odds style evidence, positive is occupied
+const int8_t GRID_MAX_EVIDENCE = 8;
+const int8_t GRID_OCCUPIED_EVIDENCE = 3;
+const int8_t VISION_HIT_EVIDENCE = 3;
+const int8_t VISION_FREE_EVIDENCE = -1;
+const int8_t RANGE_HIT_EVIDENCE = 2;
+const int8_t RANGE_FREE_EVIDENCE = -1;
+
+// Where the camera's coarse bins land in front of the rover
+const float SECTOR_BEARING_DEG[SECTOR_COUNT] = {-25, 0, 25};
+const float SECTOR_HALF_WIDTH_DEG = 10;
+const float RANGE_DISTANCE_CM[RANGE_COUNT] = {30, 60, 100};
+
+const float RANGE_SENSOR_MAX_CM = 100;           // free space assumed up to here without an echo
+const unsigned long RANGE_EVIDENCE_INTERVAL_MS = 100;
+const unsigned long GRID_DECAY_INTERVAL_MS = 2000;   // stale evidence fades by one step
+const float GRID_SHIFT_HEADING_RAD = 0.1;
+
+void setupOccupancyGrid(RangeSensor* sensor);
+
+// Call every loop: follows odometry, fuses the range sensor and ages evidence
+void updateOccupancyGrid();
+
+// Obstacle report from the camera for the frame just analysed
+void addVisionEvidence(const ObstacleReport& report);
+
+// Cell index along either axis for a rover frame coordinate
+inline int gridIndex(float cm) {
+  return (int)lroundf(cm / GRID_CELL_CM) + GRID_HALF;
+}
+
+// col 0 is the left edge, row 0 the rear edge; out of range cells read as unknown (0)
+int8_t cellEvidence(int col, int row);
+bool cellOccupied(int col, int row);
+bool occupiedAt(float xCm, float yCm);
+
+void clearOccupancyGrid();
+void printOccupancyGrid();
+
+#endif //OCCUPANCY_GRID_H
@@ -0,0 +1,47 @@
+#include "odometry.h"
+#include "drive.h"
+
+// Motors are stopped from the safety task as well as the loop
+portMUX_TYPE odometryMux = portMUX_INITIALIZER_UNLOCKED;
+Pose pose = {0, 0, 0};
+unsigned long lastOdometryUs = 0;
+
+Pose integratePose(const Pose& from, float leftCmPerSec, float rightCmPerSec, float steerRad, float seconds) {
+  float speed = (leftCmPerSec + rightCmPerSec) / 2;
+  float travelHeading = from.headingRad + steerRad;
+  Pose next;
+  next.xCm = from.xCm + speed * sinf(travelHeading) * seconds;
+  next.yCm = from.yCm + speed * cosf(travelHeading) * seconds;
+  next.headingRad = from.headingRad + (leftCmPerSec - rightCmPerSec) / TRACK_WIDTH_CM * seconds;
+  return next;
+}
+
+// The clock read and the interval both inside the lock: if the safety task
+// stops the motors mid-update, its interval can't overlap this one
+void updateOdometry() {
+  portENTER_CRITICAL(&odometryMux);
+  unsigned long now = micros();
+  float seconds = (now - lastOdometryUs) / 1000000.0;
+  float leftCmPerSec = leftMotorSpeed() * FULL_SPEED_CM_PER_SEC / MAX_SPEED;
+  float rightCmPerSec = rightMotorSpeed() * FULL_SPEED_CM_PER_SEC / MAX_SPEED;
+  // All four wheels steer to the same angle, so the rover crabs along it
+  float steerRad = radians(steeringAngle() - CENTER_ANGLE);
+  pose = integratePose(pose, leftCmPerSec, rightCmPerSec, steerRad, seconds);
+  lastOdometryUs = now;
+  portEXIT_CRITICAL(&odometryMux);
+}
+
+Pose currentPose() {
+  updateOdometry();
+  portENTER_CRITICAL(&odometryMux);
+  Pose snapshot = pose;
+  portEXIT_CRITICAL(&odometryMux);
+  return snapshot;
+}
+
+void resetOdometry() {
+  portENTER_CRITICAL(&odometryMux);
+  pose = {0, 0, 0};
+  lastOdometryUs = micros();
+  portEXIT_CRITICAL(&odometryMux);
+}
@@ -0,0 +1,27 @@
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <Arduino.h>
+
+// Dead reckoning from the commanded drive output, there are no wheel encoders
+const float FULL_SPEED_CM_PER_SEC = 40;
+const float TRACK_WIDTH_CM = 30;
+
+// x to the right, y forward at power-on, heading in radians, positive to the right
+struct Pose {
+  float xCm;
+  float yCm;
+  float headingRad;
+};
+
+// The motion model: crab along the steering angle, yaw from the speed
+// difference between the sides. Speeds in cm/s, steering relative to centre.
+Pose integratePose(const Pose& from, float leftCmPerSec, float rightCmPerSec, float steerRad, float seconds);
+
+// Integrates the pose up to now with the drive output that has been applied
+// since the last call. drive.cpp calls this before every change of output.
+void updateOdometry();
+Pose currentPose();
+void resetOdometry();
+
+#endif //ODOMETRY_H
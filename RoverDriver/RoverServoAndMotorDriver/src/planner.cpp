@@ -0,0 +1,187 @@
+#include "planner.h"
+#include "drive.h"
+#include "odometry.h"
+#include "occupancyGrid.h"
+#include "loopProfiler.h"
+
+int sequenceCount() {
+  int count = 1;
+  for (int step = 0; step < PLAN_STEPS; step++) {
+    count *= PLANNER_CANDIDATE_COUNT;
+  }
+  return count;
+}
+
+const int PLAN_SEQUENCES = sequenceCount();
+
+struct FootprintCell {
+  int8_t col;
+  int8_t row;
+};
+
+const int MAX_FOOTPRINT_CELLS = 49;
+FootprintCell footprint[MAX_FOOTPRINT_CELLS];
+int footprintSize = 0;
+
+bool planRequested = false;
+int nextSequence = 0;
+int bestSequence = 0;
+float bestCost = 0;
+
+unsigned long plansMade = 0;
+unsigned long plansBlocked = 0;
+uint64_t totalTickUs = 0;
+unsigned long ticks = 0;
+uint32_t worstTickUs = 0;
+unsigned long rollouts = 0;
+
+// Cell offsets covered by the rover's body, built once
+void buildFootprint() {
+  int radius = ceilf(ROVER_RADIUS_CM / GRID_CELL_CM);
+  float limit = ROVER_RADIUS_CM / GRID_CELL_CM + 0.5;
+  footprintSize = 0;
+  for (int row = -radius; row <= radius; row++) {
+    for (int col = -radius; col <= radius; col++) {
+      if (col * col + row * row <= limit * limit && footprintSize < MAX_FOOTPRINT_CELLS) {
+        footprint[footprintSize++] = {(int8_t)col, (int8_t)row};
+      }
+    }
+  }
+}
+
+// Cost of the rover's body at pose, or a negative value if it hits something
+float footprintCost(const Pose& pose) {
+  int centerCol = gridIndex(pose.xCm);
+  int centerRow = gridIndex(pose.yCm);
+  float cost = 0;
+  for (int i = 0; i < footprintSize; i++) {
+    int col = centerCol + footprint[i].col;
+    int row = centerRow + footprint[i].row;
+    int8_t evidence = cellEvidence(col, row);
+    if (evidence >= GRID_OCCUPIED_EVIDENCE) {
+      return -1;
+    }
+    if (evidence > 0) {
+      cost += EVIDENCE_WEIGHT * evidence;
+    } else if (evidence == 0) {
+      cost += UNKNOWN_WEIGHT;
+    }
+  }
+  return cost;
+}
+
+const DriveCommand& sequenceStep(int sequence, int step) {
+  for (int i = 0; i < step; i++) {
+    sequence /= PLANNER_CANDIDATE_COUNT;
+  }
+  return PLANNER_CANDIDATES[sequence % PLANNER_CANDIDATE_COUNT];
+}
+
+// Rolls a sequence out from the grid's origin, which the grid keeps within a
+// cell of the rover
+float rolloutCost(int sequence) {
+  // Waiting first is only worth it as the plain stop, sequence 0
+  if (sequence != 0 && isStopCommand(sequenceStep(sequence, 0))) {
+    return INFINITY;
+  }
+  rollouts++;
+  Pose pose = {0, 0, 0};
+  float cost = 0;
+  for (int step = 0; step < PLAN_STEPS; step++) {
+    const DriveCommand& command = sequenceStep(sequence, step);
+    int leftSpeed;
+    int rightSpeed;
+    sideSpeedsFor(command, leftSpeed, rightSpeed);
+    float leftCmPerSec = leftSpeed * FULL_SPEED_CM_PER_SEC / MAX_SPEED;
+    float rightCmPerSec = rightSpeed * FULL_SPEED_CM_PER_SEC / MAX_SPEED;
+    float steerRad = radians(steeringAngleFor(command.curvature) - CENTER_ANGLE);
+    cost += TURN_WEIGHT * abs(command.curvature) / MAX_CURVATURE;
+
+    for (int elapsed = 0; elapsed < command.durationMs; elapsed += ROLLOUT_STEP_MS) {
+      pose = integratePose(pose, leftCmPerSec, rightCmPerSec, steerRad, ROLLOUT_STEP_MS / 1000.0);
+      float bodyCost = footprintCost(pose);
+      if (bodyCost < 0) {
+        return INFINITY;
+      }
+      cost += bodyCost;
+    }
+  }
+  return cost - PROGRESS_WEIGHT * pose.yCm;
+}
+
+void requestPlan() {
+  planRequested = true;
+  nextSequence = 0;
+  // Standing still is always possible, everything else has to beat it
+  bestSequence = 0;
+  bestCost = 0;
+}
+
+bool planPending() {
+  return planRequested;
+}
+
+bool planStep(DriveCommand& next) {
+  if (!planRequested) {
+    return false;
+  }
+  if (footprintSize == 0) {
+    buildFootprint();
+  }
+  uint32_t startCycles = ESP.getCycleCount();
+  unsigned long startUs = micros();
+
+  int end = min(nextSequence + PLANNER_ROLLOUTS_PER_TICK, PLAN_SEQUENCES);
+  for (; nextSequence < end; nextSequence++) {
+    float cost = rolloutCost(nextSequence);
+    if (cost < bestCost) {
+      bestCost = cost;
+      bestSequence = nextSequence;
+    }
+  }
+
+  uint32_t tickUs = elapsedUs(startCycles, startUs);
+  totalTickUs += tickUs;
+  ticks++;
+  worstTickUs = max(worstTickUs, tickUs);
+
+  if (nextSequence < PLAN_SEQUENCES) {
+    return false;
+  }
+  planRequested = false;
+  plansMade++;
+  next = sequenceStep(bestSequence, 0);
+  if (isStopCommand(next)) {
+    plansBlocked++;
+  }
+  return true;
+}
+
+void benchmarkPlanner(int runs) {
+  if (footprintSize == 0) {
+    buildFootprint();
+  }
+  uint32_t worstUs = 0;
+  uint64_t totalUs = 0;
+  for (int run = 0; run < runs; run++) {
+    uint32_t startCycles = ESP.getCycleCount();
+    unsigned long startUs = micros();
+    for (int sequence = 0; sequence < PLAN_SEQUENCES; sequence++) {
+      rolloutCost(sequence);
+    }
+    uint32_t us = elapsedUs(startCycles, startUs);
+    totalUs += us;
+    worstUs = max(worstUs, us);
+  }
+  Serial.printf("[Plan] Bench: %d plans of %d rollouts, mean %lu us, worst %lu us, %lu us per rollout\n", runs,
+                PLAN_SEQUENCES, (unsigned long)(totalUs / runs), (unsigned long)worstUs,
+                (unsigned long)(totalUs / runs / PLAN_SEQUENCES));
+}
+
+void printPlannerStats() {
+  Serial.printf("[Plan] %d candidates, %d steps, %d sequences, %d footprint cells\n", PLANNER_CANDIDATE_COUNT,
+                PLAN_STEPS, PLAN_SEQUENCES, footprintSize);
+  Serial.printf("[Plan] Plans: %lu (%lu chose to stay put), rollouts: %lu\n", plansMade, plansBlocked, rollouts);
+  Serial.printf("[Plan] Per tick mean: %lu us, worst: %lu us over %lu ticks\n",
+                ticks ? (unsigned long)(totalTickUs / ticks) : 0, (unsigned long)worstTickUs, ticks);
+}
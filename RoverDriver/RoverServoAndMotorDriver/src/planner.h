@@ -0,0 +1,47 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <Arduino.h>
+#include "driveCommand.h"
+
+// Receding horizon planner over the occupancy grid. Every sequence of
+// PLAN_STEPS candidate maneuvers is rolled out with the odometry motion model
+// and scored; the first step of the best one is driven, then it replans.
+const int PLAN_STEPS = 2;
+const int PLAN_STEP_MS = 1000;
+const int ROLLOUT_STEP_MS = 100;
+const float ROVER_RADIUS_CM = 20;
+
+// Work per loop() is bounded by the number of rollouts per call
+const int PLANNER_ROLLOUTS_PER_TICK = 6;
+const int PLANNER_BENCH_RUNS = 20;
+
+const DriveCommand PLANNER_CANDIDATES[] = {
+  STOP_PRESET,
+  {0, MAX_SPEED, PLAN_STEP_MS},
+  {-MAX_CURVATURE / 2, MAX_SPEED, PLAN_STEP_MS},
+  {MAX_CURVATURE / 2, MAX_SPEED, PLAN_STEP_MS},
+  {-MAX_CURVATURE, MAX_SPEED, PLAN_STEP_MS},
+  {MAX_CURVATURE, MAX_SPEED, PLAN_STEP_MS},
+};
+const int PLANNER_CANDIDATE_COUNT = sizeof(PLANNER_CANDIDATES) / sizeof(PLANNER_CANDIDATES[0]);
+
+// Cost terms, progress is per cm forward of the start pose
+const float PROGRESS_WEIGHT = 1.0;
+const float EVIDENCE_WEIGHT = 2.0;    // per unit of occupied evidence under the footprint, per rollout step
+const float UNKNOWN_WEIGHT = 0.2;     // per unknown cell under the footprint, per rollout step
+const float TURN_WEIGHT = 10.0;       // at full curvature, per step
+
+// Asks for a new plan, e.g. after the grid changed or a maneuver ended
+void requestPlan();
+bool planPending();
+
+// Evaluates up to PLANNER_ROLLOUTS_PER_TICK sequences. Returns true when a
+// requested plan has been finished, with its first maneuver in next.
+bool planStep(DriveCommand& next);
+
+// Runs whole plans back to back over the current grid and reports their cost
+void benchmarkPlanner(int runs);
+void printPlannerStats();
+
+#endif //PLANNER_H
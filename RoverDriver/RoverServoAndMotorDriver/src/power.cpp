@@ -0,0 +1,157 @@
+#include "power.h"
+#include "esp_pm.h"
+#include "drive.h"
+
+enum CommandKind : uint8_t {
+  KIND_STOP,
+  KIND_FORWARD,
+  KIND_REVERSE,
+  KIND_TURN,
+  KIND_COUNT,
+  KIND_NONE = KIND_COUNT,
+};
+
+const char* const COMMAND_KIND_NAMES[KIND_COUNT] = {"STOP", "FORWARD", "REVERSE", "TURN"};
+
+struct CommandEnergy {
+  unsigned long count;
+  float totalMilliJoules;
+};
+
+bool idle = false;
+bool lightSleepAvailable = false;
+
+unsigned long lastEnergyUpdateUs = 0;
+float totalMilliJoules = 0;
+float commandStartMilliJoules = 0;
+CommandKind currentKind = KIND_NONE;
+CommandEnergy commandEnergy[KIND_COUNT];
+
+unsigned long idleWakeups = 0;
+unsigned long totalWakeLatencyUs = 0;
+unsigned long worstWakeLatencyUs = 0;
+unsigned long idleTimeMs = 0;
+
+bool configureLightSleep(bool enable) {
+  esp_pm_config_esp32_t pmConfig;
+  pmConfig.max_freq_mhz = ACTIVE_CPU_MHZ;
+  // DFS only while parked, active mode stays at full clock for the profiler's cycle counts
+  pmConfig.min_freq_mhz = enable ? IDLE_CPU_MHZ : ACTIVE_CPU_MHZ;
+  pmConfig.light_sleep_enable = enable;
+  return esp_pm_configure(&pmConfig) == ESP_OK;
+}
+
+void setupPower() {
+  // Stock Arduino builds ship without CONFIG_PM_ENABLE, in which case we fall
+  // back to modem sleep and a lower clock
+  lightSleepAvailable = configureLightSleep(false);
+  lastEnergyUpdateUs = micros();
+  Serial.println(lightSleepAvailable ? "[Power] Automatic light sleep available"
+                                     : "[Power] No power management, idle uses modem sleep only");
+}
+
+void enterIdle() {
+  if (idle) {
+    return;
+  }
+  updateEnergy();
+  idle = true;
+  WiFi.setSleep(true);
+  if (lightSleepAvailable) {
+    configureLightSleep(true);
+  } else {
+    setCpuFrequencyMhz(IDLE_CPU_MHZ);
+  }
+}
+
+void exitIdle() {
+  if (!idle) {
+    return;
+  }
+  updateEnergy();
+  idle = false;
+  if (lightSleepAvailable) {
+    configureLightSleep(false);
+  } else {
+    setCpuFrequencyMhz(ACTIVE_CPU_MHZ);
+  }
+  WiFi.setSleep(false);
+}
+
+bool isIdle() {
+  return idle;
+}
+
+void idleUntil(unsigned long wakeAtMs) {
+  unsigned long start = millis();
+  while ((long)(wakeAtMs - millis()) > 0 && !Serial.available()) {
+    unsigned long sliceMs = min((unsigned long)IDLE_SLICE_MS, wakeAtMs - millis());
+    unsigned long sliceStartUs = micros();
+    // The idle task (or tickless light sleep) takes over until the tick fires
+    vTaskDelay(pdMS_TO_TICKS(sliceMs));
+    unsigned long overshootUs = micros() - sliceStartUs;
+    overshootUs = overshootUs > sliceMs * 1000 ? overshootUs - sliceMs * 1000 : 0;
+
+    idleWakeups++;
+    totalWakeLatencyUs += overshootUs;
+    if (overshootUs > worstWakeLatencyUs) {
+      worstWakeLatencyUs = overshootUs;
+    }
+    updateEnergy();
+  }
+  idleTimeMs += millis() - start;
+}
+
+void updateEnergy() {
+  unsigned long now = micros();
+  float seconds = (now - lastEnergyUpdateUs) / 1000000.0;
+  lastEnergyUpdateUs = now;
+
+  float logicMilliWatts = ACTIVE_LOGIC_MW;
+  if (idle) {
+    logicMilliWatts = lightSleepAvailable ? LIGHT_SLEEP_LOGIC_MW : IDLE_LOGIC_MW;
+  }
+  float motorMilliWatts = driveDirection() != 0 ? MOTOR_MW : 0;
+  totalMilliJoules += (logicMilliWatts + motorMilliWatts) * seconds;
+}
+
+CommandKind commandKind(const DriveCommand& command) {
+  if (isStopCommand(command)) {
+    return KIND_STOP;
+  }
+  if (command.curvature != 0) {
+    return KIND_TURN;
+  }
+  return command.speed < 0 ? KIND_REVERSE : KIND_FORWARD;
+}
+
+void recordCommandEnergy(const DriveCommand& command) {
+  updateEnergy();
+  if (currentKind != KIND_NONE) {
+    commandEnergy[currentKind].count++;
+    commandEnergy[currentKind].totalMilliJoules += totalMilliJoules - commandStartMilliJoules;
+  }
+  currentKind = commandKind(command);
+  commandStartMilliJoules = totalMilliJoules;
+}
+
+void printPowerReport() {
+  updateEnergy();
+  float seconds = millis() / 1000.0;
+  float averageMilliWatts = seconds > 0 ? totalMilliJoules / seconds : 0;
+  float usedWh = totalMilliJoules / 3600000.0;
+
+  Serial.printf("[Power] Mode: %s, idle %lu ms of %lu ms\n", idle ? "idle" : "active", idleTimeMs, millis());
+  Serial.printf("[Power] Wake-ups: %lu, mean latency: %lu us, worst: %lu us\n", idleWakeups,
+                idleWakeups ? totalWakeLatencyUs / idleWakeups : 0, worstWakeLatencyUs);
+  Serial.printf("[Power] Used %.1f J (%.3f Wh), average %.0f mW\n", totalMilliJoules / 1000, usedWh, averageMilliWatts);
+  if (averageMilliWatts > 0) {
+    Serial.printf("[Power] Estimated battery left: %.1f h at this rate\n",
+                  (BATTERY_WH - usedWh) * 1000 / averageMilliWatts);
+  }
+  for (int kind = 0; kind < KIND_COUNT; kind++) {
+    const CommandEnergy& entry = commandEnergy[kind];
+    Serial.printf("  %-10s x%lu, %.1f J per command\n", COMMAND_KIND_NAMES[kind], entry.count,
+                  entry.count ? entry.totalMilliJoules / entry.count / 1000 : 0);
+  }
+}
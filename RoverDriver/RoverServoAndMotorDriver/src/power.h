@@ -0,0 +1,39 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "driveCommand.h"
+
+const int ACTIVE_CPU_MHZ = 240;
+const int IDLE_CPU_MHZ = 80;
+const int IDLE_SLICE_MS = 50;   // longest we sleep before checking Serial again
+
+// Rough draw figures for the energy estimate, in milliwatts
+const float ACTIVE_LOGIC_MW = 3.3 * 130;       // 240MHz, radio always on
+const float IDLE_LOGIC_MW = 3.3 * 30;          // 80MHz with modem sleep
+const float LIGHT_SLEEP_LOGIC_MW = 3.3 * 8;    // auto light sleep between DTIM beacons
+const float MOTOR_MW = 6 * 7.4 * 250;          // six drive motors at ~250mA each
+const float BATTERY_WH = 7.4 * 2.2;            // 2S 2200mAh pack
+
+void setupPower();
+
+// Modem sleep, lower clock and, when the build has power management enabled,
+// automatic light sleep. Only used while the rover is parked.
+void enterIdle();
+void exitIdle();
+bool isIdle();
+
+// Sleeps until millis() reaches wakeAtMs or Serial input arrives
+void idleUntil(unsigned long wakeAtMs);
+
+// Integrates the estimated draw since the last call; call once per loop
+void updateEnergy();
+
+// Closes the energy bucket of the previous command and opens one for this
+// one. Buckets are per kind of motion, the planner's commands rarely repeat.
+void recordCommandEnergy(const DriveCommand& command);
+
+void printPowerReport();
+
+#endif //POWER_H
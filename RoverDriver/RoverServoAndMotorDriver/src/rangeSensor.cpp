@@ -0,0 +1,84 @@
+#include "rangeSensor.h"
+#include "drive.h"
+
+const unsigned long ECHO_TIMEOUT_US = 12000;   // ~2m round trip, anything further reads as clear
+const unsigned long TRIGGER_INTERVAL_US = 30000;
+const float US_PER_CM = 58.0;
+
+UltrasonicRangeSensor::UltrasonicRangeSensor(int trigPin, int echoPin)
+  : trigPin(trigPin), echoPin(echoPin) {}
+
+void UltrasonicRangeSensor::begin() {
+  pinMode(trigPin, OUTPUT);
+  pinMode(echoPin, INPUT);
+  digitalWrite(trigPin, LOW);
+  attachInterruptArg(digitalPinToInterrupt(echoPin), onEcho, this, CHANGE);
+}
+
+void IRAM_ATTR UltrasonicRangeSensor::onEcho(void* arg) {
+  UltrasonicRangeSensor* sensor = static_cast<UltrasonicRangeSensor*>(arg);
+  unsigned long now = micros();
+  if (digitalRead(sensor->echoPin) == HIGH) {
+    sensor->echoStartUs = now;
+  } else if (sensor->waitingForEcho) {
+    sensor->lastEchoUs = now - sensor->echoStartUs;
+    sensor->lastSampleUs = now;
+    sensor->waitingForEcho = false;
+  }
+}
+
+void UltrasonicRangeSensor::update() {
+  unsigned long now = micros();
+  if (waitingForEcho) {
+    if (now - triggerTimeUs < ECHO_TIMEOUT_US) {
+      return;
+    }
+    // No echo back in time, nothing within range
+    waitingForEcho = false;
+    lastEchoUs = -1;
+    lastSampleUs = now;
+  }
+  if (now - triggerTimeUs < TRIGGER_INTERVAL_US) {
+    return;
+  }
+
+  triggerTimeUs = now;
+  waitingForEcho = true;
+  digitalWrite(trigPin, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(trigPin, LOW);
+}
+
+float UltrasonicRangeSensor::distanceCm() const {
+  long echoUs = lastEchoUs;
+  return echoUs < 0 ? -1 : echoUs / US_PER_CM;
+}
+
+unsigned long UltrasonicRangeSensor::sampleTimeUs() const {
+  return lastSampleUs;
+}
+
+void SimulatedRangeSensor::update() {
+  unsigned long now = micros();
+  if (simulatedDistanceCm >= 0 && driveDirection() > 0) {
+    float travelled = closingSpeedCmPerSec * (now - lastSampleUs) / 1000000.0;
+    simulatedDistanceCm = max(0.0f, simulatedDistanceCm - travelled);
+  }
+  lastSampleUs = now;
+}
+
+float SimulatedRangeSensor::distanceCm() const {
+  return simulatedDistanceCm;
+}
+
+unsigned long SimulatedRangeSensor::sampleTimeUs() const {
+  return lastSampleUs;
+}
+
+void SimulatedRangeSensor::setDistance(float cm) {
+  simulatedDistanceCm = cm;
+}
+
+void SimulatedRangeSensor::setClosingSpeed(float cmPerSecond) {
+  closingSpeedCmPerSec = cmPerSecond;
+}
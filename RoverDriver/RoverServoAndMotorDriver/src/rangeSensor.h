@@ -0,0 +1,60 @@
+#ifndef RANGE_SENSOR_H
+#define RANGE_SENSOR_H
+
+#include <Arduino.h>
+
+// Forward facing distance sensor polled by the safety layer every control tick.
+// update() must never block for a full measurement; readings complete in the background.
+class RangeSensor {
+public:
+  virtual ~RangeSensor() {}
+  virtual void begin() {}
+  virtual void update() = 0;
+
+  // Last completed reading in cm, or -1 when nothing is in range
+  virtual float distanceCm() const = 0;
+  // micros() timestamp of the last completed reading
+  virtual unsigned long sampleTimeUs() const = 0;
+};
+
+// HC-SR04 style sensor. The echo pulse is timed from a pin interrupt so a
+// reading never holds up the control tick. Echo is 5V: use a divider on ECHO.
+class UltrasonicRangeSensor : public RangeSensor {
+public:
+  UltrasonicRangeSensor(int trigPin, int echoPin);
+  void begin() override;
+  void update() override;
+  float distanceCm() const override;
+  unsigned long sampleTimeUs() const override;
+
+private:
+  static void IRAM_ATTR onEcho(void* arg);
+
+  int trigPin;
+  int echoPin;
+  unsigned long triggerTimeUs = 0;
+  volatile unsigned long echoStartUs = 0;
+  volatile unsigned long lastSampleUs = 0;
+  // Raw echo width, converted on read: no floating point in the ISR
+  volatile long lastEchoUs = -1;
+  volatile bool waitingForEcho = false;
+};
+
+// Stand-in for bench work without a sensor. The obstacle closes in while the
+// motors drive forward; set its distance over Serial with "sim <cm>".
+class SimulatedRangeSensor : public RangeSensor {
+public:
+  void update() override;
+  float distanceCm() const override;
+  unsigned long sampleTimeUs() const override;
+
+  void setDistance(float cm);
+  void setClosingSpeed(float cmPerSecond);
+
+private:
+  volatile float simulatedDistanceCm = -1;
+  float closingSpeedCmPerSec = 30;
+  unsigned long lastSampleUs = 0;
+};
+
+#endif //RANGE_SENSOR_H
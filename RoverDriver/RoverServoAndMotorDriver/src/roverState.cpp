@@ -0,0 +1,43 @@
+#include "roverState.h"
+#include "flightRecorder.h"
+
+const char* const MODE_NAMES[MODE_COUNT] = {"IDLE", "MOVING", "TURNING", "STOPPING", "FAILSAFE"};
+
+const char* roverModeName(RoverMode mode) {
+  return MODE_NAMES[(int)mode];
+}
+
+bool RoverStateMachine::dispatch(RoverEvent event) {
+  RoverMode next = nextMode(currentMode, event);
+  if (next == NO_TRANSITION) {
+    return false;
+  }
+  enter(next);
+  return true;
+}
+
+void RoverStateMachine::enter(RoverMode mode) {
+  unsigned long now = micros();
+  modeTimeUs[(int)currentMode] += now - enteredAtUs;
+  enteredAtUs = now;
+  modeEntries[(int)mode]++;
+  recordFlightEvent(FLIGHT_MODE, (int)mode, (int)currentMode);
+  currentMode = mode;
+}
+
+unsigned long RoverStateMachine::timeInModeMs(RoverMode mode) const {
+  uint64_t total = modeTimeUs[(int)mode];
+  if (mode == currentMode) {
+    total += micros() - enteredAtUs;
+  }
+  return total / 1000;
+}
+
+void RoverStateMachine::printProfile() const {
+  Serial.printf("[State] Current mode: %s\n", roverModeName(currentMode));
+  for (int i = 0; i < MODE_COUNT; i++) {
+    RoverMode mode = (RoverMode)i;
+    Serial.printf("  %-9s entered %lu times, %lu ms total\n", roverModeName(mode),
+                  (unsigned long)modeEntries[i], timeInModeMs(mode));
+  }
+}
@@ -0,0 +1,104 @@
+#ifndef ROVER_STATE_H
+#define ROVER_STATE_H
+
+#include <Arduino.h>
+
+enum class RoverMode : uint8_t {
+  Idle,
+  Moving,
+  Turning,
+  Stopping,
+  Failsafe,
+  Count
+};
+
+enum class RoverEvent : uint8_t {
+  DriveCommand,   // straight forward or backward
+  TurnCommand,    // any command with curvature
+  StopCommand,
+  ManeuverDone,   // command duration elapsed
+  Settled,        // wheels centred after stopping
+  Fault,          // safety stop or lost link
+  Recover,
+  Count
+};
+
+const int MODE_COUNT = (int)RoverMode::Count;
+const int EVENT_COUNT = (int)RoverEvent::Count;
+
+// Marks an illegal transition in the table
+constexpr RoverMode NO_TRANSITION = RoverMode::Count;
+
+namespace transitions {
+constexpr RoverMode Idle = RoverMode::Idle;
+constexpr RoverMode Moving = RoverMode::Moving;
+constexpr RoverMode Turning = RoverMode::Turning;
+constexpr RoverMode Stopping = RoverMode::Stopping;
+constexpr RoverMode Failsafe = RoverMode::Failsafe;
+constexpr RoverMode X = NO_TRANSITION;
+
+constexpr RoverMode TABLE[MODE_COUNT][EVENT_COUNT] = {
+  //              Drive    Turn     Stop      Done      Settled  Fault     Recover
+  /* Idle */     {Moving,  Turning, Idle,     X,        X,       Failsafe, X},
+  /* Moving */   {X,       X,       Stopping, Stopping, X,       Failsafe, X},
+  /* Turning */  {X,       X,       Stopping, Stopping, X,       Failsafe, X},
+  /* Stopping */ {X,       X,       Stopping, X,        Idle,    Failsafe, X},
+  /* Failsafe */ {X,       X,       Failsafe, X,        X,       Failsafe, Idle},
+};
+}
+
+constexpr RoverMode nextMode(RoverMode mode, RoverEvent event) {
+  return transitions::TABLE[(int)mode][(int)event];
+}
+
+constexpr bool isLegalTransition(RoverMode mode, RoverEvent event) {
+  return nextMode(mode, event) != NO_TRANSITION;
+}
+
+constexpr bool faultAlwaysFailsafe(int mode = 0) {
+  return mode == MODE_COUNT ||
+         (nextMode((RoverMode)mode, RoverEvent::Fault) == RoverMode::Failsafe && faultAlwaysFailsafe(mode + 1));
+}
+
+constexpr bool failsafeOnlyLeftByRecover(int event = 0) {
+  return event == EVENT_COUNT ||
+         ((event == (int)RoverEvent::Recover ||
+           !isLegalTransition(RoverMode::Failsafe, (RoverEvent)event) ||
+           nextMode(RoverMode::Failsafe, (RoverEvent)event) == RoverMode::Failsafe) &&
+          failsafeOnlyLeftByRecover(event + 1));
+}
+
+static_assert(faultAlwaysFailsafe(), "Every mode must fall into Failsafe on a fault");
+static_assert(failsafeOnlyLeftByRecover(), "Failsafe may only be left through Recover");
+static_assert(isLegalTransition(RoverMode::Stopping, RoverEvent::StopCommand), "STOP must always be accepted");
+
+const char* roverModeName(RoverMode mode);
+
+class RoverStateMachine {
+public:
+  RoverMode mode() const { return currentMode; }
+
+  // Constant time table lookup, returns false and stays put on an illegal event
+  bool dispatch(RoverEvent event);
+
+  // For call sites that know the current mode statically: an illegal
+  // transition fails to compile instead of being ignored at runtime
+  template <RoverMode From, RoverEvent Event>
+  void fire() {
+    static_assert(isLegalTransition(From, Event), "Illegal rover mode transition");
+    enter(nextMode(From, Event));
+  }
+
+  unsigned long timeInModeMs(RoverMode mode) const;
+  void printProfile() const;
+
+private:
+  void enter(RoverMode mode);
+
+  RoverMode currentMode = RoverMode::Idle;
+  unsigned long enteredAtUs = 0;
+  uint64_t modeTimeUs[MODE_COUNT] = {};
+  uint32_t modeEntries[MODE_COUNT] = {};
+};
+
+#endif //ROVER_STATE_H
@@ -0,0 +1,92 @@
+#include "safety.h"
+#include "drive.h"
+#include "flightRecorder.h"
+
+RangeSensor* safetySensor = nullptr;
+volatile bool forwardBlocked = false;
+volatile bool tripPending = false;
+
+SafetyIntervention interventions[SAFETY_LOG_SIZE];
+int interventionCount = 0;
+int lateInterventions = 0;   // reactions that took longer than one tick
+unsigned long worstLatencyUs = 0;
+
+void recordIntervention(float distance, unsigned long latencyUs) {
+  SafetyIntervention& entry = interventions[interventionCount % SAFETY_LOG_SIZE];
+  entry.timeMs = millis();
+  entry.distanceCm = distance;
+  entry.latencyUs = latencyUs;
+  interventionCount++;
+  recordFlightEvent(FLIGHT_SAFETY_STOP, lroundf(distance), latencyUs);
+
+  if (latencyUs > SAFETY_TICK_MS * 1000UL) {
+    lateInterventions++;
+  }
+  if (latencyUs > worstLatencyUs) {
+    worstLatencyUs = latencyUs;
+  }
+}
+
+void safetyTick() {
+  safetySensor->update();
+  float distance = safetySensor->distanceCm();
+
+  if (distance >= 0 && distance < SAFETY_STOP_DISTANCE_CM) {
+    forwardBlocked = true;
+    // Before the stop, so loop() can't put forward speed back on after it
+    setForwardInhibit(true);
+    if (driveDirection() > 0) {
+      stopMotors();
+      recordIntervention(distance, micros() - safetySensor->sampleTimeUs());
+      tripPending = true;
+    }
+  } else if (forwardBlocked && (distance < 0 || distance > SAFETY_CLEAR_DISTANCE_CM)) {
+    forwardBlocked = false;
+    setForwardInhibit(false);
+  }
+}
+
+void safetyTask(void* param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  while (true) {
+    safetyTick();
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SAFETY_TICK_MS));
+  }
+}
+
+void setupSafety(RangeSensor* sensor) {
+  safetySensor = sensor;
+  safetySensor->begin();
+  // Above loop() priority so the reflex runs even while loop() is busy
+  xTaskCreatePinnedToCore(safetyTask, "safety", 4096, nullptr, 3, nullptr, 1);
+  Serial.println("[Safety] Reflex layer started");
+}
+
+bool safetyBlocksForward() {
+  return forwardBlocked;
+}
+
+bool safetyTripped() {
+  if (!tripPending) {
+    return false;
+  }
+  tripPending = false;
+  return true;
+}
+
+bool safetyAllowsRecovery() {
+  return leftMotorSpeed() == 0 && rightMotorSpeed() == 0;
+}
+
+void printSafetyReport() {
+  Serial.printf("[Safety] Distance: %.1f cm, forward blocked: %s\n",
+                safetySensor->distanceCm(), forwardBlocked ? "yes" : "no");
+  Serial.printf("[Safety] Interventions: %d, slower than one tick: %d, worst latency: %lu us\n",
+                interventionCount, lateInterventions, worstLatencyUs);
+
+  int first = max(0, interventionCount - SAFETY_LOG_SIZE);
+  for (int i = first; i < interventionCount; i++) {
+    const SafetyIntervention& entry = interventions[i % SAFETY_LOG_SIZE];
+    Serial.printf("  #%d at %lu ms: %.1f cm, %lu us\n", i, entry.timeMs, entry.distanceCm, entry.latencyUs);
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef SAFETY_H
+#define SAFETY_H
+
+#include <Arduino.h>
+#include "rangeSensor.h"
+
+const int SAFETY_TICK_MS = 20;
+const float SAFETY_STOP_DISTANCE_CM = 35;
+const float SAFETY_CLEAR_DISTANCE_CM = 50;   // hysteresis before forward motion is allowed again
+const int SAFETY_LOG_SIZE = 16;
+
+struct SafetyIntervention {
+  unsigned long timeMs;
+  float distanceCm;
+  unsigned long latencyUs;   // sensor reading to motors cut
+};
+
+// Starts the reflex task. It checks the sensor every SAFETY_TICK_MS, independent
+// of loop(), so a blocking HTTP poll can't delay a stop.
+void setupSafety(RangeSensor* sensor);
+
+// True while something is inside the stop distance; forward commands must be refused
+bool safetyBlocksForward();
+
+// Returns true once for every stop the reflex layer made since the last call
+bool safetyTripped();
+
+// True once the motors are off after a fault. The forward inhibit keeps the
+// rover off the obstacle on its own, so failsafe can hand back to idle and
+// let it reverse or turn away.
+bool safetyAllowsRecovery();
+
+void printSafetyReport();
+
+#endif //SAFETY_H
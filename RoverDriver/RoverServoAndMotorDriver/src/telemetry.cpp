@@ -0,0 +1,31 @@
+#include "telemetry.h"
+#include "odometry.h"
+#include "loopProfiler.h"
+
+uint16_t executedCommands = 0;
+
+void noteCommandExecuted() {
+  executedCommands++;
+}
+
+uint16_t saturate16(unsigned long value) {
+  return value > 0xFFFF ? 0xFFFF : value;
+}
+
+RoverTelemetry collectTelemetry(uint8_t mode, float maneuverProgress) {
+  Pose pose = currentPose();
+  unsigned long loopMeanUs, loopMaxUs;
+  loopProfilerWindow(loopMeanUs, loopMaxUs);
+
+  RoverTelemetry telemetry;
+  telemetry.executedSeq = executedCommands;
+  telemetry.progress = constrain(maneuverProgress, 0.0f, 1.0f) * 255;
+  telemetry.mode = mode;
+  telemetry.poseXCm = constrain(lroundf(pose.xCm), -32768L, 32767L);
+  telemetry.poseYCm = constrain(lroundf(pose.yCm), -32768L, 32767L);
+  telemetry.headingDeciDeg = lroundf(degrees(remainderf(pose.headingRad, 2 * PI)) * 10);
+  telemetry.loopMeanUs = saturate16(loopMeanUs);
+  telemetry.loopMaxUs = saturate16(loopMaxUs);
+  telemetry.freeHeapKb = ESP.getFreeHeap() / 1024;
+  return telemetry;
+}
@@ -0,0 +1,13 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "commandPacket.h"
+
+void noteCommandExecuted();
+
+// Snapshot for the next poll. Loop timing covers the iterations since the
+// previous snapshot, so each poll reports its own window.
+RoverTelemetry collectTelemetry(uint8_t mode, float maneuverProgress);
+
+#endif //TELEMETRY_H
@@ -0,0 +1,36 @@
+#include "uartTransport.h"
+
+UartCommandTransport::UartCommandTransport(HardwareSerial& port, int rxPin, int txPin)
+  : PacketCommandTransport(UART_ACK_TIMEOUT_MS), port(port), rxPin(rxPin), txPin(txPin) {}
+
+void UartCommandTransport::begin() {
+  // Called from setup(), before WiFi, and again after every WiFi reconnect
+  if (started) {
+    return;
+  }
+  started = true;
+  port.setRxBufferSize(UART_RX_BUFFER_SIZE);
+  port.begin(UART_LINK_BAUD, SERIAL_8N1, rxPin, txPin);
+  Serial.printf("[UART] Command link at %lu baud\n", (unsigned long)UART_LINK_BAUD);
+}
+
+bool UartCommandTransport::writePacket(const uint8_t* data, size_t length) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  size_t frameLength = encodeFrame(data, length, frame);
+  return port.write(frame, frameLength) == frameLength;
+}
+
+size_t UartCommandTransport::readPacket(CommandPacket& packet) {
+  while (port.available()) {
+    if (decoder.feed(port.read())) {
+      memcpy(&packet, &decoder.packet(), decoder.length());
+      return decoder.length();
+    }
+  }
+  return 0;
+}
+
+void UartCommandTransport::printStats() const {
+  PacketCommandTransport::printStats();
+  Serial.printf("[UART] CRC errors: %lu, framing errors: %lu\n", decoder.crcErrors, decoder.framingErrors);
+}
@@ -0,0 +1,38 @@
+#ifndef UART_TRANSPORT_H
+#define UART_TRANSPORT_H
+
+#include <Arduino.h>
+#include "commandTransport.h"
+#include "uartFrame.h"
+
+const unsigned long UART_ACK_TIMEOUT_MS = 150;
+// The UART driver moves bytes from the RX FIFO into this ring buffer from its
+// interrupt, so a frame arriving during a blocking call isn't lost. That is
+// the receive path instead of DMA: the ESP32's UART DMA goes through the UHCI
+// peripheral, which the IDF 4.4 under Arduino-ESP32 2.x has no driver for.
+// A full 128 byte FIFO takes 1.4 ms at 921600 baud and a frame is at most 57
+// bytes, so the interrupt fires about once per frame, close to what a DMA
+// completion interrupt would cost.
+const size_t UART_RX_BUFFER_SIZE = 1024;
+
+// Framed packets over a dedicated UART to the camera on the same chassis
+class UartCommandTransport : public PacketCommandTransport {
+public:
+  UartCommandTransport(HardwareSerial& port, int rxPin, int txPin);
+  void begin() override;
+  const char* name() const override { return "UART"; }
+  void printStats() const override;
+
+protected:
+  bool writePacket(const uint8_t* data, size_t length) override;
+  size_t readPacket(CommandPacket& packet) override;
+
+private:
+  HardwareSerial& port;
+  int rxPin;
+  int txPin;
+  bool started = false;
+  FrameDecoder decoder;
+};
+
+#endif //UART_TRANSPORT_H
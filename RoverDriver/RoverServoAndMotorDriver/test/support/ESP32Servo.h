@@ -0,0 +1,25 @@
+#ifndef HOST_ESP32_SERVO_H
+#define HOST_ESP32_SERVO_H
+
+// Only so drive.h builds on the host; the tests don't drive hardware
+#include <Arduino.h>
+
+class Servo {
+public:
+  void setPeriodHertz(int hertz) {}
+  int attach(int pin, int minUs = 500, int maxUs = 2500) { return pin; }
+  void write(int value) { angle = value; }
+  int read() { return angle; }
+
+private:
+  int angle = 90;
+};
+
+class ESP32PWM {
+public:
+  static void allocateTimer(int timer) {}
+  void attachPin(int pin, double frequency = 1000, int resolution = 8) {}
+  void write(uint32_t duty) {}
+};
+
+#endif //HOST_ESP32_SERVO_H
@@ -0,0 +1,19 @@
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+// HttpCommandTransport compiles against this on the host; its requests
+// always fail, the native tests only drive the packet transports
+#include <Arduino.h>
+
+class HTTPClient {
+public:
+  bool begin(const char*) { return true; }
+  void collectHeaders(const char* const[], size_t) {}
+  int GET() { return -1; }
+  String getString() { return String(); }
+  bool hasHeader(const char*) { return false; }
+  String header(const char*) { return String(); }
+  void end() {}
+};
+
+#endif //HOST_HTTP_CLIENT_H
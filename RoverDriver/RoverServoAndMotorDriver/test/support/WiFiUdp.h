@@ -0,0 +1,17 @@
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+// UdpCommandTransport compiles against this on the host; nothing is sent
+#include <Arduino.h>
+
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t) { return 1; }
+  int beginPacket(const char*, uint16_t) { return 1; }
+  size_t write(const uint8_t*, size_t length) { return length; }
+  int endPacket() { return 1; }
+  int parsePacket() { return 0; }
+  int read(unsigned char*, size_t) { return 0; }
+};
+
+#endif //HOST_WIFI_UDP_H
@@ -0,0 +1,120 @@
+// Governor table lookup, and a small simulation of how far the rover drives
+// on a decision as the vision pipeline falls behind.
+// Run with: pio test -e native -f test_governor
+#include <unity.h>
+#include "driveCommand.cpp"
+#include "governor.cpp"
+#include "odometry.h"
+
+// Distance a command covers, straight line at its speed for its duration
+float commandDistanceCm(const DriveCommand& command) {
+  return command.speed * FULL_SPEED_CM_PER_SEC / MAX_SPEED * command.durationMs / 1000.0;
+}
+
+void setUp() {
+  averageDecisionAgeMs = 0;
+  governedCommands = 0;
+  totalSpeedScale = 0;
+  lowestSpeedScale = 1;
+  totalDistanceScale = 0;
+}
+
+void tearDown() {}
+
+void test_fast_decisions_are_not_governed() {
+  noteDecisionAge(800);
+  DriveCommand governed = governCommand(FORWARD_PRESET, 600);
+  TEST_ASSERT_EQUAL(FORWARD_PRESET.speed, governed.speed);
+  TEST_ASSERT_EQUAL(FORWARD_PRESET.durationMs, governed.durationMs);
+}
+
+void test_scales_interpolate_between_rows() {
+  float speedScale, durationScale;
+  lookupScales(4000, speedScale, durationScale);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 0.70, speedScale);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 0.625, durationScale);
+  lookupScales(60000, speedScale, durationScale);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, GOVERNOR_TABLE[GOVERNOR_STEPS - 1].speedScale, speedScale);
+}
+
+// An old command is slowed even while recent decisions have been fresh
+void test_command_age_overrides_a_fast_average() {
+  noteDecisionAge(500);
+  DriveCommand governed = governCommand(FORWARD_PRESET, 5000);
+  TEST_ASSERT_EQUAL(lroundf(MAX_SPEED * 0.60), governed.speed);
+  TEST_ASSERT_EQUAL(MOVEMENT_DELAY / 2, governed.durationMs);
+}
+
+void test_average_follows_old_decisions() {
+  noteDecisionAge(1000);
+  for (int i = 0; i < 20; i++) {
+    noteDecisionAge(9000);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(50, 9000, averageDecisionAgeMs);
+  DriveCommand governed = governCommand(TURN_LEFT_PRESET, 0);
+  TEST_ASSERT_LESS_THAN(MAX_SPEED / 2, governed.speed);
+  TEST_ASSERT_EQUAL(TURN_LEFT_PRESET.curvature, governed.curvature);
+}
+
+// The camera answers every poll within a few ms from its cache while each
+// analysis takes 9 s. Fed the poll round trip the governor saw only the
+// link; fed each new decision's age, as main.cpp does, it sees the lag.
+void test_slow_inference_behind_a_fast_link_is_governed() {
+  const unsigned long POLL_INTERVAL_MS = 3000;
+  const unsigned long INFERENCE_MS = 9000;
+  const unsigned long LINK_MS = 20;
+  unsigned long capturedAtMs = 0;
+  unsigned long decidedAtMs = INFERENCE_MS;
+  uint16_t decisionSeq = 1;
+  uint16_t lastAgedSeq = 0;
+  for (unsigned long nowMs = POLL_INTERVAL_MS; nowMs <= 60000; nowMs += POLL_INTERVAL_MS) {
+    // A new analysis starts on the frame of the moment the last one finished
+    while (nowMs >= decidedAtMs + INFERENCE_MS) {
+      capturedAtMs = decidedAtMs;
+      decidedAtMs += INFERENCE_MS;
+      decisionSeq++;
+    }
+    if (nowMs < decidedAtMs || decisionSeq == lastAgedSeq) {
+      continue;
+    }
+    lastAgedSeq = decisionSeq;
+    noteDecisionAge(nowMs + LINK_MS - capturedAtMs);
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(INFERENCE_MS, (unsigned long)averageDecisionAgeMs);
+  DriveCommand governed = governCommand(FORWARD_PRESET, 0);
+  TEST_ASSERT_LESS_THAN(MAX_SPEED / 2, governed.speed);
+}
+
+// The simulation: a FORWARD decided on a frame latencyMs old. Ungoverned the
+// rover covers the same ground whatever the delay; governed, the distance
+// driven on stale information shrinks as the delay grows.
+void test_simulated_distance_on_stale_decisions() {
+  const unsigned long LATENCIES[] = {500, 1500, 2500, 4000, 6000, 9000, 12000, 20000};
+  float previousCm = commandDistanceCm(FORWARD_PRESET);
+  Serial.printf("[Governor] latency ms | speed | duration ms | distance cm (ungoverned %.0f)\n", previousCm);
+  for (unsigned long latencyMs : LATENCIES) {
+    setUp();
+    for (int i = 0; i < 10; i++) {
+      noteDecisionAge(latencyMs);
+    }
+    DriveCommand governed = governCommand(FORWARD_PRESET, latencyMs);
+    float distanceCm = commandDistanceCm(governed);
+    Serial.printf("[Governor] %10lu | %5d | %11u | %5.1f\n", latencyMs, governed.speed, governed.durationMs,
+                  distanceCm);
+    TEST_ASSERT_TRUE(distanceCm <= previousCm + 0.01);
+    previousCm = distanceCm;
+  }
+  // At the slowest rows the rover covers a sixteenth of the ungoverned distance
+  TEST_ASSERT_FLOAT_WITHIN(1.0, commandDistanceCm(FORWARD_PRESET) * 0.25 * 0.25, previousCm);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fast_decisions_are_not_governed);
+  RUN_TEST(test_scales_interpolate_between_rows);
+  RUN_TEST(test_command_age_overrides_a_fast_average);
+  RUN_TEST(test_average_follows_old_decisions);
+  RUN_TEST(test_slow_inference_behind_a_fast_link_is_governed);
+  RUN_TEST(test_simulated_distance_on_stale_decisions);
+  return UNITY_END();
+}
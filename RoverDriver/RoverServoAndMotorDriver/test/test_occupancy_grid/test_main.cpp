@@ -0,0 +1,215 @@
+// The occupancy grid following the rover as odometry moves it, camera
+// evidence landing where the bins say, and the planner's choices and per-tick
+// cost over the grid.
+// Run with: pio test -e native -f test_occupancy_grid
+#include <unity.h>
+#include "driveCommand.cpp"
+#include "odometry.cpp"
+#include "occupancyGrid.cpp"
+#include "planner.cpp"
+
+// Stand-ins for drive.cpp. The rover is moved by setting odometry's pose,
+// the planner only needs the command to actuator mapping.
+int leftMotorSpeed() { return 0; }
+int rightMotorSpeed() { return 0; }
+int steeringAngle() { return CENTER_ANGLE; }
+
+int steeringAngleFor(int curvature) {
+  return map(constrain(curvature, -MAX_CURVATURE, MAX_CURVATURE), -MAX_CURVATURE, MAX_CURVATURE, LEFT_ANGLE,
+             RIGHT_ANGLE);
+}
+
+void sideSpeedsFor(const DriveCommand& command, int& leftSpeed, int& rightSpeed) {
+  float innerScale = 1.0 - (1.0 - TURN_INNER_SPEED_RATIO) * abs(command.curvature) / MAX_CURVATURE;
+  int innerSpeed = lroundf(command.speed * innerScale);
+  leftSpeed = command.curvature < 0 ? innerSpeed : command.speed;
+  rightSpeed = command.curvature < 0 ? command.speed : innerSpeed;
+}
+
+uint32_t elapsedUs(uint32_t startCycles, unsigned long startUs) {
+  return micros() - startUs;
+}
+
+void moveTo(float xCm, float yCm, float headingDeg) {
+  pose = {xCm, yCm, (float)radians(headingDeg)};
+  updateOccupancyGrid();
+}
+
+// Evidence at a rover frame position, as a range hit would leave it
+void markOccupied(float xCm, float yCm) {
+  grid[gridIndex(yCm)][gridIndex(xCm)] = GRID_MAX_EVIDENCE;
+}
+
+int occupiedCells() {
+  int count = 0;
+  for (int row = 0; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      count += cellOccupied(col, row);
+    }
+  }
+  return count;
+}
+
+void setUp() {
+  hostClockUs = 0;
+  hostRealClock = false;
+  pose = {0, 0, 0};
+  lastOdometryUs = 0;
+  setupOccupancyGrid(nullptr);
+  gridShifts = 0;
+  planRequested = false;
+}
+
+void tearDown() {}
+
+void test_driving_forward_brings_obstacles_closer() {
+  markOccupied(0, 50);
+  moveTo(0, 20, 0);
+  TEST_ASSERT_EQUAL(1, gridShifts);
+  TEST_ASSERT_TRUE(occupiedAt(0, 30));
+  TEST_ASSERT_FALSE(occupiedAt(0, 50));
+  TEST_ASSERT_EQUAL(1, occupiedCells());
+}
+
+// Heading is positive to the right, so after a right turn what was ahead is on the left
+void test_turning_swings_obstacles_around() {
+  markOccupied(0, 50);
+  moveTo(0, 0, 90);
+  TEST_ASSERT_TRUE(occupiedAt(-50, 0));
+  moveTo(0, 0, 180);
+  TEST_ASSERT_TRUE(occupiedAt(0, -50));
+  TEST_ASSERT_EQUAL(1, occupiedCells());
+}
+
+void test_motion_under_a_cell_does_not_shift() {
+  markOccupied(20, 40);
+  moveTo(3, 6, 4);
+  TEST_ASSERT_EQUAL(0, gridShifts);
+  TEST_ASSERT_TRUE(occupiedAt(20, 40));
+}
+
+void test_evidence_leaving_the_grid_is_dropped() {
+  markOccupied(0, -90);
+  moveTo(0, 30, 0);
+  TEST_ASSERT_EQUAL(0, occupiedCells());
+  // What comes into view at the front is unknown, not free
+  TEST_ASSERT_EQUAL(0, cellEvidence(GRID_HALF, GRID_CELLS - 1));
+}
+
+// Shifts in cell sized steps round a quarter circle and back along the same
+// path. Each shift resamples to the nearest cell, so after 18 shifts a hit
+// ends up to a cell off or smeared into a neighbour, but no further and never lost.
+void test_repeated_shifts_keep_obstacles_in_place() {
+  const float WORLD_X = 30;
+  const float WORLD_Y = 60;
+  markOccupied(WORLD_X, WORLD_Y);
+  const int STEPS = 9;
+  for (int step = 1; step <= STEPS; step++) {
+    moveTo(step * 4.0, step * 10.0, 90.0 * step / STEPS);
+  }
+  for (int step = STEPS - 1; step >= 0; step--) {
+    moveTo(step * 4.0, step * 10.0, 90.0 * step / STEPS);
+  }
+  TEST_ASSERT_EQUAL(2 * STEPS, gridShifts);
+  int cells = occupiedCells();
+  TEST_ASSERT_GREATER_OR_EQUAL(1, cells);
+  TEST_ASSERT_LESS_OR_EQUAL(2, cells);
+  for (int row = 0; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      if (cellOccupied(col, row)) {
+        TEST_ASSERT_LESS_OR_EQUAL(1, abs(col - gridIndex(WORLD_X)));
+        TEST_ASSERT_LESS_OR_EQUAL(1, abs(row - gridIndex(WORLD_Y)));
+      }
+    }
+  }
+}
+
+void test_vision_report_marks_its_sector() {
+  ObstacleReport report = {0, {}};
+  addObstacle(report, SECTOR_MIDDLE, RANGE_MEDIUM);
+  for (int i = 0; i < 2; i++) {
+    addVisionEvidence(report);
+  }
+  TEST_ASSERT_TRUE(occupiedAt(0, RANGE_DISTANCE_CM[RANGE_MEDIUM]));
+  // Cleared up to the obstacle, and the empty sectors out to FAR
+  TEST_ASSERT_LESS_THAN(0, cellEvidence(GRID_HALF, gridIndex(20)));
+  TEST_ASSERT_LESS_THAN(0, cellEvidence(gridIndex(-20), gridIndex(50)));
+}
+
+// Plans to completion in ticks, returning the first maneuver
+DriveCommand planToCompletion(int& ticksTaken) {
+  requestPlan();
+  DriveCommand next;
+  ticksTaken = 0;
+  while (!planStep(next)) {
+    ticksTaken++;
+  }
+  ticksTaken++;
+  return next;
+}
+
+void test_planner_drives_straight_on_a_clear_path() {
+  for (int row = GRID_HALF; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      grid[row][col] = VISION_FREE_EVIDENCE;
+    }
+  }
+  int ticksTaken;
+  DriveCommand next = planToCompletion(ticksTaken);
+  TEST_ASSERT_EQUAL(0, next.curvature);
+  TEST_ASSERT_GREATER_THAN(0, next.speed);
+  TEST_ASSERT_EQUAL((PLAN_SEQUENCES + PLANNER_ROLLOUTS_PER_TICK - 1) / PLANNER_ROLLOUTS_PER_TICK, ticksTaken);
+}
+
+void test_planner_steers_around_an_obstacle_ahead() {
+  for (int row = GRID_HALF; row < GRID_CELLS; row++) {
+    for (int col = 0; col < GRID_CELLS; col++) {
+      grid[row][col] = VISION_FREE_EVIDENCE;
+    }
+  }
+  for (float x = -10; x <= 10; x += GRID_CELL_CM) {
+    markOccupied(x, 50);
+  }
+  int ticksTaken;
+  DriveCommand next = planToCompletion(ticksTaken);
+  TEST_ASSERT_NOT_EQUAL(0, next.curvature);
+}
+
+void test_planner_stays_put_when_boxed_in() {
+  for (float x = -60; x <= 60; x += GRID_CELL_CM) {
+    markOccupied(x, 30);
+  }
+  int ticksTaken;
+  TEST_ASSERT_TRUE(isStopCommand(planToCompletion(ticksTaken)));
+}
+
+// The on-board benchmark on the host, and the per-tick bound the loop relies on
+void test_planner_benchmark() {
+  markOccupied(-20, 50);
+  markOccupied(30, 70);
+  hostRealClock = true;
+  benchmarkPlanner(PLANNER_BENCH_RUNS);
+  ticks = 0;
+  totalTickUs = 0;
+  worstTickUs = 0;
+  for (int run = 0; run < PLANNER_BENCH_RUNS; run++) {
+    int ticksTaken;
+    planToCompletion(ticksTaken);
+  }
+  printPlannerStats();
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_driving_forward_brings_obstacles_closer);
+  RUN_TEST(test_turning_swings_obstacles_around);
+  RUN_TEST(test_motion_under_a_cell_does_not_shift);
+  RUN_TEST(test_evidence_leaving_the_grid_is_dropped);
+  RUN_TEST(test_repeated_shifts_keep_obstacles_in_place);
+  RUN_TEST(test_vision_report_marks_its_sector);
+  RUN_TEST(test_planner_drives_straight_on_a_clear_path);
+  RUN_TEST(test_planner_steers_around_an_obstacle_ahead);
+  RUN_TEST(test_planner_stays_put_when_boxed_in);
+  RUN_TEST(test_planner_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,268 @@
+// Loopback test of the packet transport's seq/ack/retry logic against a
+// simulated camera, with injected loss and a link that reorders packets.
+// Run with: pio test -e native -f test_packet_transport
+#include <unity.h>
+#include <random>
+#include <vector>
+#include "commandTransport.cpp"
+
+struct InFlight {
+  uint64_t deliverAtUs;
+  std::vector<uint8_t> bytes;
+};
+
+// Both directions of the link plus the camera end. The camera follows
+// packetService.cpp: it replays its answer for a repeat of the last seq and
+// acks and answers any other seq, including an older one that was overtaken.
+class LoopbackTransport : public PacketCommandTransport {
+public:
+  LoopbackTransport() : PacketCommandTransport(UDP_ACK_TIMEOUT_MS) {}
+  const char* name() const override { return "Loopback"; }
+
+  // Each packet takes between minLatencyMs and maxLatencyMs, so a spread
+  // wider than the gap between packets delivers them out of order
+  unsigned long minLatencyMs = 5;
+  unsigned long maxLatencyMs = 5;
+
+  unsigned long cameraRequests = 0;
+  unsigned long cameraReplays = 0;
+  unsigned long reordered = 0;
+  bool dropAnswers = false;
+
+  static String answerFor(uint16_t seq) { return "CMD" + String((unsigned int)seq); }
+
+protected:
+  bool writePacket(const uint8_t* data, size_t length) override {
+    toCamera.push_back({deliveryTime(), std::vector<uint8_t>(data, data + length)});
+    return true;
+  }
+
+  size_t readPacket(CommandPacket& packet) override {
+    runCamera();
+    return take(toRover, (uint8_t*)&packet);
+  }
+
+private:
+  uint64_t deliveryTime() {
+    std::uniform_int_distribution<unsigned long> spread(minLatencyMs, maxLatencyMs);
+    return hostClockUs + spread(jitter) * 1000ULL;
+  }
+
+  // Hands out the earliest packet that has arrived, counting overtakes
+  size_t take(std::vector<InFlight>& queue, uint8_t* out) {
+    int earliest = -1;
+    for (size_t i = 0; i < queue.size(); i++) {
+      if (queue[i].deliverAtUs <= hostClockUs &&
+          (earliest < 0 || queue[i].deliverAtUs < queue[earliest].deliverAtUs)) {
+        earliest = i;
+      }
+    }
+    if (earliest < 0) {
+      return 0;
+    }
+    if (earliest > 0) {
+      reordered++;
+    }
+    size_t length = queue[earliest].bytes.size();
+    memcpy(out, queue[earliest].bytes.data(), length);
+    queue.erase(queue.begin() + earliest);
+    return length;
+  }
+
+  void sendToRover(PacketType type, uint16_t seq, const uint8_t* payload, size_t length) {
+    CommandPacket packet;
+    length = buildPacket(packet, type, seq, payload, length);
+    const uint8_t* bytes = (const uint8_t*)&packet;
+    toRover.push_back({deliveryTime(), std::vector<uint8_t>(bytes, bytes + length)});
+  }
+
+  void sendAnswer(uint16_t seq) {
+    if (dropAnswers) {
+      return;
+    }
+    uint8_t payload[MAX_PACKET_PAYLOAD];
+    CommandStamp stamp = {100, 3000, 1};
+    ObstacleReport obstacles = {0, {}};
+    size_t length = buildCommandPayload(payload, answerFor(seq), stamp, &obstacles);
+    sendToRover(PACKET_COMMAND, seq, payload, length);
+  }
+
+  void runCamera() {
+    CommandPacket packet;
+    size_t length;
+    while ((length = take(toCamera, (uint8_t*)&packet)) > 0) {
+      if (!validPacket(packet, length) || packet.header.type != PACKET_REQUEST) {
+        continue;
+      }
+      uint16_t seq = packet.header.seq;
+      if (hasServed && seq == lastServedSeq) {
+        cameraReplays++;
+        sendAnswer(seq);
+        continue;
+      }
+      cameraRequests++;
+      lastServedSeq = seq;
+      hasServed = true;
+      sendToRover(PACKET_ACK, seq, nullptr, 0);
+      sendAnswer(seq);
+    }
+  }
+
+  std::vector<InFlight> toCamera;
+  std::vector<InFlight> toRover;
+  std::mt19937 jitter{42};
+  uint16_t lastServedSeq = 0;
+  bool hasServed = false;
+};
+
+const int POLLS = 200;
+RoverTelemetry telemetry;
+
+struct RunResult {
+  int delivered;
+  int wrongAnswers;
+  unsigned long totalLatencyMs;
+  unsigned long worstLatencyMs;
+};
+
+// Polls like loop() does and checks every command answers its own request
+RunResult runPolls(LoopbackTransport& link) {
+  RunResult result = {0, 0, 0, 0};
+  for (int i = 0; i < POLLS; i++) {
+    uint16_t seq = i + 1;
+    CommandMessage message;
+    unsigned long start = millis();
+    if (link.fetchCommand("FORWARD", telemetry, message)) {
+      unsigned long latency = millis() - start;
+      result.delivered++;
+      result.totalLatencyMs += latency;
+      result.worstLatencyMs = max(result.worstLatencyMs, latency);
+      if (message.command != LoopbackTransport::answerFor(seq)) {
+        result.wrongAnswers++;
+      }
+    }
+    advanceClockMs(100);
+  }
+  link.printStats();
+  Serial.printf("[Loopback] Camera analysed %lu, replayed %lu, %lu packets overtaken\n", link.cameraRequests,
+                link.cameraReplays, link.reordered);
+  return result;
+}
+
+void setUp() {
+  hostClockUs = 0;
+  randomSeed(7);
+  memset(&telemetry, 0, sizeof(telemetry));
+}
+
+void tearDown() {}
+
+// A decision published before its reply was parsed goes out without a report,
+// which the rover must not read as "nothing seen"
+void test_command_payload_tells_no_report_from_an_empty_one() {
+  CommandPacket packet;
+  uint8_t payload[MAX_PACKET_PAYLOAD];
+  CommandStamp stamp = {120, 3000, 7};
+  String command;
+  CommandStamp parsedStamp;
+  bool hasObstacles;
+  ObstacleReport obstacles;
+
+  ObstacleReport seen = {0, {}};
+  addObstacle(seen, SECTOR_MIDDLE, RANGE_CLOSE);
+  buildPacket(packet, PACKET_COMMAND, 3, payload, buildCommandPayload(payload, "FORWARD", stamp, &seen));
+  TEST_ASSERT_TRUE(parseCommandPayload(packet, command, parsedStamp, hasObstacles, obstacles));
+  TEST_ASSERT_TRUE(hasObstacles);
+  TEST_ASSERT_EQUAL(1, obstacles.count);
+  TEST_ASSERT_EQUAL(7, parsedStamp.decisionSeq);
+  TEST_ASSERT_EQUAL_STRING("FORWARD", command.c_str());
+
+  ObstacleReport empty = {0, {}};
+  buildPacket(packet, PACKET_COMMAND, 4, payload, buildCommandPayload(payload, "FORWARD", stamp, &empty));
+  TEST_ASSERT_TRUE(parseCommandPayload(packet, command, parsedStamp, hasObstacles, obstacles));
+  TEST_ASSERT_TRUE(hasObstacles);
+  TEST_ASSERT_EQUAL(0, obstacles.count);
+
+  buildPacket(packet, PACKET_COMMAND, 5, payload, buildCommandPayload(payload, "FORWARD", stamp, nullptr));
+  TEST_ASSERT_TRUE(parseCommandPayload(packet, command, parsedStamp, hasObstacles, obstacles));
+  TEST_ASSERT_FALSE(hasObstacles);
+  TEST_ASSERT_EQUAL(0, obstacles.count);
+  TEST_ASSERT_EQUAL_STRING("FORWARD", command.c_str());
+}
+
+// Every attempt waiting out both timeouts, plus the polling granularity
+unsigned long worstPollMs() {
+  return PACKET_MAX_ATTEMPTS * (UDP_ACK_TIMEOUT_MS + RESPONSE_TIMEOUT_MS + 2);
+}
+
+void test_clean_link_delivers_every_poll_first_time() {
+  LoopbackTransport link;
+  RunResult result = runPolls(link);
+  TEST_ASSERT_EQUAL(POLLS, result.delivered);
+  TEST_ASSERT_EQUAL(0, result.wrongAnswers);
+  TEST_ASSERT_EQUAL(POLLS, link.cameraRequests);
+  TEST_ASSERT_EQUAL(0, link.cameraReplays);
+  TEST_ASSERT_LESS_OR_EQUAL(20UL, result.worstLatencyMs);
+}
+
+// 20% each way: an attempt survives when its request and answer both do, so
+// four attempts fail together about 2% of the time
+void test_retries_recover_from_injected_loss() {
+  LoopbackTransport link;
+  link.setInjectedLoss(20);
+  RunResult result = runPolls(link);
+  TEST_ASSERT_GREATER_OR_EQUAL(POLLS * 95 / 100, result.delivered);
+  TEST_ASSERT_EQUAL(0, result.wrongAnswers);
+  // A retried seq is replayed by the camera, not analysed again
+  TEST_ASSERT_GREATER_THAN(0UL, link.cameraReplays);
+  TEST_ASSERT_LESS_OR_EQUAL((unsigned long)POLLS, link.cameraRequests);
+  TEST_ASSERT_LESS_OR_EQUAL(worstPollMs(), result.worstLatencyMs);
+  Serial.printf("[Loopback] 20%% loss: %d/%d delivered, mean %lu ms, worst %lu ms\n", result.delivered, POLLS,
+                result.delivered ? result.totalLatencyMs / result.delivered : 0, result.worstLatencyMs);
+}
+
+// Latency spread past the ack timeout: answers to a retried or abandoned seq
+// turn up during later polls and must not be taken for the current answer
+void test_late_and_reordered_answers_are_not_mistaken() {
+  LoopbackTransport link;
+  link.minLatencyMs = 1;
+  link.maxLatencyMs = 400;
+  RunResult result = runPolls(link);
+  TEST_ASSERT_GREATER_THAN(0UL, link.reordered);
+  TEST_ASSERT_GREATER_OR_EQUAL(POLLS * 95 / 100, result.delivered);
+  TEST_ASSERT_EQUAL(0, result.wrongAnswers);
+}
+
+void test_loss_and_reordering_together() {
+  LoopbackTransport link;
+  link.minLatencyMs = 1;
+  link.maxLatencyMs = 250;
+  link.setInjectedLoss(10);
+  RunResult result = runPolls(link);
+  TEST_ASSERT_GREATER_OR_EQUAL(POLLS * 95 / 100, result.delivered);
+  TEST_ASSERT_EQUAL(0, result.wrongAnswers);
+}
+
+// Requests and acks get through but every answer is lost: the poll gives up
+// within its bound instead of holding loop() while a maneuver runs on
+void test_lost_answers_fail_fast() {
+  LoopbackTransport link;
+  link.dropAnswers = true;
+  CommandMessage message;
+  unsigned long start = millis();
+  TEST_ASSERT_FALSE(link.fetchCommand("FULL_STOP", telemetry, message));
+  unsigned long elapsedMs = millis() - start;
+  TEST_ASSERT_LESS_OR_EQUAL(worstPollMs(), elapsedMs);
+  Serial.printf("[Loopback] All answers lost: gave up after %lu ms\n", elapsedMs);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_command_payload_tells_no_report_from_an_empty_one);
+  RUN_TEST(test_clean_link_delivers_every_poll_first_time);
+  RUN_TEST(test_retries_recover_from_injected_loss);
+  RUN_TEST(test_late_and_reordered_answers_are_not_mistaken);
+  RUN_TEST(test_loss_and_reordering_together);
+  RUN_TEST(test_lost_answers_fail_fast);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+// The reflex layer's trip through failsafe and back: a stop for an obstacle
+// must not strand the rover in front of it.
+// Run with: pio test -e native -f test_safety
+#include <unity.h>
+#include "driveCommand.cpp"
+#include "odometry.cpp"
+#include "drive.cpp"
+#include "safety.cpp"
+#include "roverState.cpp"
+
+void recordFlightEvent(FlightEventType type, int16_t a, int32_t b, int32_t c) {}
+
+class FixedRangeSensor : public RangeSensor {
+public:
+  void update() override { sampleUs = micros(); }
+  float distanceCm() const override { return distance; }
+  unsigned long sampleTimeUs() const override { return sampleUs; }
+
+  float distance = -1;
+  unsigned long sampleUs = 0;
+};
+
+FixedRangeSensor sensor;
+RoverStateMachine rover;
+
+// The event main.cpp raises for a command, and the drive it applies on entry
+bool runCommand(const DriveCommand& command) {
+  RoverEvent event = command.curvature != 0 ? RoverEvent::TurnCommand : RoverEvent::DriveCommand;
+  if (!rover.dispatch(event)) {
+    return false;
+  }
+  applyDrive(command);
+  return true;
+}
+
+// Drives forward into an obstacle and lets the reflex stop it
+void tripOnObstacle() {
+  TEST_ASSERT_TRUE(runCommand(FORWARD_PRESET));
+  advanceClockMs(SAFETY_TICK_MS);
+  sensor.distance = SAFETY_STOP_DISTANCE_CM - 15;
+  safetyTick();
+  TEST_ASSERT_TRUE(safetyTripped());
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::Fault));
+  TEST_ASSERT_EQUAL((int)RoverMode::Failsafe, (int)rover.mode());
+}
+
+void setUp() {
+  hostClockUs = 0;
+  setupDrive();
+  sensor = FixedRangeSensor();
+  safetySensor = &sensor;
+  forwardBlocked = false;
+  tripPending = false;
+  setForwardInhibit(false);
+  rover = RoverStateMachine();
+}
+
+void tearDown() {}
+
+void test_trip_stops_the_motors() {
+  tripOnObstacle();
+  TEST_ASSERT_EQUAL(0, leftMotorSpeed());
+  TEST_ASSERT_EQUAL(0, rightMotorSpeed());
+  TEST_ASSERT_TRUE(safetyBlocksForward());
+}
+
+void test_backward_moves_after_a_trip() {
+  tripOnObstacle();
+  // The obstacle hasn't gone anywhere
+  TEST_ASSERT_TRUE(safetyAllowsRecovery());
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::Recover));
+  TEST_ASSERT_TRUE(runCommand(BACKWARD_PRESET));
+  advanceClockMs(SAFETY_TICK_MS);
+  safetyTick();
+  TEST_ASSERT_EQUAL((int)RoverMode::Moving, (int)rover.mode());
+  TEST_ASSERT_EQUAL(-MAX_SPEED, leftMotorSpeed());
+  TEST_ASSERT_EQUAL(-MAX_SPEED, rightMotorSpeed());
+  TEST_ASSERT_FALSE(safetyTripped());
+}
+
+void test_forward_stays_inhibited_until_clear() {
+  tripOnObstacle();
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::Recover));
+  TEST_ASSERT_TRUE(runCommand(TURN_LEFT_PRESET));
+  TEST_ASSERT_EQUAL(0, leftMotorSpeed());
+  TEST_ASSERT_EQUAL(0, rightMotorSpeed());
+
+  // Inside the hysteresis band it stays blocked, past it forward is allowed again
+  sensor.distance = SAFETY_CLEAR_DISTANCE_CM - 5;
+  safetyTick();
+  TEST_ASSERT_TRUE(safetyBlocksForward());
+  sensor.distance = SAFETY_CLEAR_DISTANCE_CM + 5;
+  safetyTick();
+  TEST_ASSERT_FALSE(safetyBlocksForward());
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::StopCommand));
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::Settled));
+  TEST_ASSERT_TRUE(runCommand(FORWARD_PRESET));
+  TEST_ASSERT_EQUAL(MAX_SPEED, leftMotorSpeed());
+}
+
+void test_no_recovery_while_the_motors_run() {
+  setMotorSpeeds(-MAX_SPEED / 2, -MAX_SPEED / 2);
+  TEST_ASSERT_TRUE(rover.dispatch(RoverEvent::Fault));
+  TEST_ASSERT_FALSE(safetyAllowsRecovery());
+  stopMotors();
+  TEST_ASSERT_TRUE(safetyAllowsRecovery());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_trip_stops_the_motors);
+  RUN_TEST(test_backward_moves_after_a_trip);
+  RUN_TEST(test_forward_stays_inhibited_until_clear);
+  RUN_TEST(test_no_recovery_while_the_motors_run);
+  return UNITY_END();
+}
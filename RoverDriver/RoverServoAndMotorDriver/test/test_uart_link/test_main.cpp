@@ -0,0 +1,207 @@
+// The wired link on the host: FrameDecoder against clean, corrupted and
+// noisy byte streams, then UartCommandTransport round trips to a camera end
+// running in a thread on the other side of a pseudo-terminal pair.
+// Run with: pio test -e native -f test_uart_link
+#include <unity.h>
+#include <atomic>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include "commandTransport.cpp"
+#include "uartTransport.cpp"
+
+size_t framePacket(PacketType type, uint16_t seq, const uint8_t* payload, size_t length, uint8_t* frame) {
+  CommandPacket packet;
+  length = buildPacket(packet, type, seq, payload, length);
+  return encodeFrame((const uint8_t*)&packet, length, frame);
+}
+
+// Feeds bytes until a packet comes out, returns how many packets did
+int feedAll(FrameDecoder& decoder, const uint8_t* bytes, size_t length, uint16_t* lastSeq = nullptr) {
+  int packets = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (decoder.feed(bytes[i])) {
+      packets++;
+      if (lastSeq) {
+        *lastSeq = decoder.packet().header.seq;
+      }
+    }
+  }
+  return packets;
+}
+
+void setUp() {
+  hostClockUs = 0;
+  hostRealClock = false;
+}
+
+void tearDown() {}
+
+void test_frame_round_trip() {
+  uint8_t payload[MAX_PACKET_PAYLOAD];
+  for (int i = 0; i < MAX_PACKET_PAYLOAD; i++) {
+    payload[i] = i * 7;
+  }
+  uint8_t frame[MAX_FRAME_SIZE];
+  size_t length = framePacket(PACKET_COMMAND, 513, payload, MAX_PACKET_PAYLOAD, frame);
+  TEST_ASSERT_EQUAL(MAX_FRAME_SIZE, length);
+
+  FrameDecoder decoder;
+  TEST_ASSERT_EQUAL(1, feedAll(decoder, frame, length));
+  TEST_ASSERT_EQUAL(PACKET_COMMAND, decoder.packet().header.type);
+  TEST_ASSERT_EQUAL(513, decoder.packet().header.seq);
+  TEST_ASSERT_EQUAL_MEMORY(payload, decoder.packet().payload, MAX_PACKET_PAYLOAD);
+  TEST_ASSERT_TRUE(validPacket(decoder.packet(), decoder.length()));
+}
+
+void test_corrupted_frame_is_dropped_and_the_next_one_decodes() {
+  uint8_t stream[2 * MAX_FRAME_SIZE];
+  size_t first = framePacket(PACKET_ACK, 1, nullptr, 0, stream);
+  size_t second = framePacket(PACKET_ACK, 2, nullptr, 0, stream + first);
+  stream[3] ^= 0x10;   // a bit flipped inside the first packet
+
+  FrameDecoder decoder;
+  uint16_t seq = 0;
+  TEST_ASSERT_EQUAL(1, feedAll(decoder, stream, first + second, &seq));
+  TEST_ASSERT_EQUAL(2, seq);
+  TEST_ASSERT_EQUAL(1, decoder.crcErrors);
+}
+
+// Line noise, stray SOF bytes and impossible lengths between good frames
+void test_decoder_resynchronises_after_noise() {
+  const uint8_t noise[] = {0x00, 0xFF, FRAME_SOF, 0x00, 0x13, FRAME_SOF, 0xF0, 0x42};
+  uint8_t stream[512];
+  size_t length = 0;
+  for (int i = 1; i <= 5; i++) {
+    memcpy(stream + length, noise, sizeof(noise));
+    length += sizeof(noise);
+    length += framePacket(PACKET_REQUEST, i, (const uint8_t*)"FORWARD", 7, stream + length);
+  }
+
+  FrameDecoder decoder;
+  uint16_t seq = 0;
+  TEST_ASSERT_EQUAL(5, feedAll(decoder, stream, length, &seq));
+  TEST_ASSERT_EQUAL(5, seq);
+  TEST_ASSERT_GREATER_THAN(0UL, decoder.framingErrors);
+}
+
+// The camera end: acks and answers every request, optionally with noise
+// written between frames
+struct PtyCamera {
+  int fd;
+  std::atomic<bool> running{true};
+  bool noisy = false;
+  unsigned long requests = 0;
+
+  void run() {
+    FrameDecoder decoder;
+    while (running) {
+      pollfd waiting = {fd, POLLIN, 0};
+      if (poll(&waiting, 1, 10) <= 0) {
+        continue;
+      }
+      uint8_t bytes[64];
+      ssize_t length = ::read(fd, bytes, sizeof(bytes));
+      for (ssize_t i = 0; i < length; i++) {
+        if (decoder.feed(bytes[i]) && decoder.packet().header.type == PACKET_REQUEST) {
+          answer(decoder.packet().header.seq);
+        }
+      }
+    }
+  }
+
+  void answer(uint16_t seq) {
+    requests++;
+    uint8_t frame[MAX_FRAME_SIZE];
+    if (noisy && requests % 3 == 0) {
+      const uint8_t noise[] = {FRAME_SOF, 0x01, 0x55};
+      ::write(fd, noise, sizeof(noise));
+    }
+    ::write(fd, frame, framePacket(PACKET_ACK, seq, nullptr, 0, frame));
+
+    uint8_t payload[MAX_PACKET_PAYLOAD];
+    CommandStamp stamp = {50, 3000, seq};
+    ObstacleReport obstacles = {0, {}};
+    String command = "CMD" + String((unsigned int)seq);
+    size_t length = buildCommandPayload(payload, command, stamp, &obstacles);
+    ::write(fd, frame, framePacket(PACKET_COMMAND, seq, payload, length, frame));
+  }
+};
+
+void makeRaw(int fd) {
+  termios settings;
+  tcgetattr(fd, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(fd, TCSANOW, &settings);
+}
+
+// Runs polls over a fresh pty pair, counting the answers that came back
+void runPtyRoundTrips(int polls, bool noisy, int& delivered, int& wrongAnswers) {
+  delivered = 0;
+  wrongAnswers = 0;
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(master >= 0);
+  grantpt(master);
+  unlockpt(master);
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(slave >= 0);
+  makeRaw(slave);
+
+  PtyCamera camera;
+  camera.fd = slave;
+  camera.noisy = noisy;
+  std::thread cameraThread(&PtyCamera::run, &camera);
+
+  hostRealClock = true;
+  HardwareSerial port(master);
+  UartCommandTransport rover(port, -1, -1);
+  rover.begin();
+  RoverTelemetry telemetry;
+  memset(&telemetry, 0, sizeof(telemetry));
+
+  unsigned long totalUs = 0;
+  unsigned long worstUs = 0;
+  for (int i = 0; i < polls; i++) {
+    CommandMessage message;
+    unsigned long start = micros();
+    if (rover.fetchCommand("FORWARD", telemetry, message)) {
+      unsigned long us = micros() - start;
+      delivered++;
+      totalUs += us;
+      worstUs = max(worstUs, us);
+      wrongAnswers += message.command != "CMD" + String((unsigned int)(i + 1));
+    }
+  }
+
+  camera.running = false;
+  cameraThread.join();
+  close(slave);
+  close(master);
+  rover.printStats();
+  Serial.printf("[UART] pty poll round trip over %d polls: mean %lu us, worst %lu us\n", delivered,
+                delivered ? totalUs / delivered : 0, worstUs);
+}
+
+void test_pty_round_trip() {
+  int delivered, wrongAnswers;
+  runPtyRoundTrips(200, false, delivered, wrongAnswers);
+  TEST_ASSERT_EQUAL(200, delivered);
+  TEST_ASSERT_EQUAL(0, wrongAnswers);
+}
+
+void test_pty_round_trip_through_line_noise() {
+  int delivered, wrongAnswers;
+  runPtyRoundTrips(60, true, delivered, wrongAnswers);
+  TEST_ASSERT_EQUAL(60, delivered);
+  TEST_ASSERT_EQUAL(0, wrongAnswers);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_round_trip);
+  RUN_TEST(test_corrupted_frame_is_dropped_and_the_next_one_decodes);
+  RUN_TEST(test_decoder_resynchronises_after_noise);
+  RUN_TEST(test_pty_round_trip);
+  RUN_TEST(test_pty_round_trip_through_line_noise);
+  return UNITY_END();
+}
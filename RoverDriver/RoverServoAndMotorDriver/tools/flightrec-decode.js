@@ -0,0 +1,124 @@
+// Decodes a dump of the rover's flightrec partition into a timeline.
+//
+//   esptool.py read_flash 0x290000 0x170000 flightrec.bin
+//   node tools/flightrec-decode.js flightrec.bin [--boot <n>] [--last <boots>]
+//
+// Layout matches src/flightRecorder.h: 4 KB sectors, each a 16 byte header
+// followed by 16 byte records until the first erased (0xFF) slot.
+const fs = require('fs');
+
+const SECTOR_SIZE = 4096;
+const RECORD_SIZE = 16;
+const SECTOR_MAGIC = 0x43455246;
+const FORMAT_VERSION = 1;
+
+const MODES = ['IDLE', 'MOVING', 'TURNING', 'STOPPING', 'FAILSAFE'];
+const FRESHNESS = ['FRESH', 'TRUNCATED', 'EXPIRED'];
+const RESET_REASONS = ['UNKNOWN', 'POWERON', 'EXT', 'SW', 'PANIC', 'INT_WDT', 'TASK_WDT', 'WDT', 'DEEPSLEEP',
+        'BROWNOUT', 'SDIO'];
+
+const formatEvent = (record) => {
+        const {type, a, b, c} = record;
+        switch (type) {
+                case 1:
+                        return `BOOT      reset reason ${RESET_REASONS[a] || a}`;
+                case 2:
+                        return `MODE      ${MODES[b] || b} -> ${MODES[a] || a}`;
+                case 3: {
+                        const curvature = (b << 0) >> 24;
+                        const speed = (b << 8) >> 24;
+                        const duration = b & 0xFFFF;
+                        return `COMMAND   curvature ${curvature}, speed ${speed}, ${duration} ms, ` +
+                                `${FRESHNESS[a] || a}, age ${c} ms`;
+                }
+                case 4:
+                        return `DRIVE     steering ${a} deg, left ${b}, right ${c}`;
+                case 5:
+                        return `SAFETY    stop at ${a} cm, ${b} us after the reading`;
+                case 6:
+                        return `POLL      ${a ? 'command' : 'FAILED'} after ${b} ms`;
+                case 7:
+                        return a ? `WIFI      connected, RSSI ${b} dBm` : 'WIFI      lost';
+                default:
+                        return `UNKNOWN   type ${type} a=${a} b=${b} c=${c}`;
+        }
+};
+
+const readSectors = (dump) => {
+        const sectors = [];
+        for (let offset = 0; offset + SECTOR_SIZE <= dump.length; offset += SECTOR_SIZE) {
+                if (dump.readUInt32LE(offset) !== SECTOR_MAGIC || dump.readUInt16LE(offset + 12) !== FORMAT_VERSION) {
+                        continue;
+                }
+                const records = [];
+                for (let slot = RECORD_SIZE; slot < SECTOR_SIZE; slot += RECORD_SIZE) {
+                        const type = dump.readUInt8(offset + slot + 4);
+                        if (type === 0xFF) {
+                                break;
+                        }
+                        records.push({
+                                timeMs: dump.readUInt32LE(offset + slot),
+                                type,
+                                sequence: dump.readUInt8(offset + slot + 5),
+                                a: dump.readInt16LE(offset + slot + 6),
+                                b: dump.readInt32LE(offset + slot + 8),
+                                c: dump.readInt32LE(offset + slot + 12),
+                        });
+                }
+                sectors.push({
+                        sequence: dump.readUInt32LE(offset + 4),
+                        boot: dump.readUInt32LE(offset + 8),
+                        records,
+                });
+        }
+        return sectors.sort((x, y) => x.sequence - y.sequence);
+};
+
+const parseArgs = (argv) => {
+        const args = {file: null, boot: null, last: null};
+        for (let i = 0; i < argv.length; i++) {
+                if (argv[i] === '--boot') {
+                        args.boot = parseInt(argv[++i], 10);
+                } else if (argv[i] === '--last') {
+                        args.last = parseInt(argv[++i], 10);
+                } else {
+                        args.file = argv[i];
+                }
+        }
+        return args;
+};
+
+const main = () => {
+        const args = parseArgs(process.argv.slice(2));
+        if (!args.file) {
+                console.error('usage: node flightrec-decode.js <dump.bin> [--boot <n>] [--last <boots>]');
+                process.exit(1);
+        }
+
+        const sectors = readSectors(fs.readFileSync(args.file));
+        let boots = [...new Set(sectors.map((sector) => sector.boot))];
+        if (args.boot !== null) {
+                boots = boots.filter((boot) => boot === args.boot);
+        } else if (args.last !== null) {
+                boots = boots.slice(-args.last);
+        }
+
+        for (const boot of boots) {
+                const records = sectors.filter((sector) => sector.boot === boot).flatMap((sector) => sector.records);
+                console.log(`=== boot ${boot}: ${records.length} events ===`);
+                let previous = null;
+                for (const record of records) {
+                        if (previous !== null) {
+                                const gap = (record.sequence - previous - 1 + 256) % 256;
+                                if (gap > 0) {
+                                        console.log(`            ... ${gap} events dropped`);
+                                }
+                        }
+                        previous = record.sequence;
+                        const seconds = (record.timeMs / 1000).toFixed(3).padStart(10);
+                        console.log(`${seconds} s  ${formatEvent(record)}`);
+                }
+        }
+};
+
+main();
@@ -1,4 +1,5 @@
 #include <ESP32Servo.h>
+#include "testSequencer.h"
 
 //SERVO SETUP
 Servo frontLeftServo;
@@ -11,6 +12,16 @@ const int SERVO_FRONT_RIGHT_PIN = 17;
 const int SERVO_BACK_LEFT_PIN = 18;
 const int SERVO_BACK_RIGHT_PIN = 19;
 
+// The front left servo's potentiometer wiper, on an ADC1 input-only pin as on
+// the rover. The other servos and the motors have no feedback.
+const int SERVO_FEEDBACK_PIN = 36;
+const int FEEDBACK_SAMPLES = 8;
+// A swing must move the wiper at least this much per degree, well under what
+// a 270 degree pot gives across the 12 bit ADC. Back at centre it must read
+// within the band of where it was at start up.
+const int FEEDBACK_MIN_COUNTS_PER_DEGREE = 3;
+const int FEEDBACK_CENTER_BAND_COUNTS = 60;
+
 // L298N MOTOR SETUP
 const int F_MOTOR_LEFT_IN1 = 2;   // F-Left motor control pin 1
 const int F_MOTOR_LEFT_IN2 = 4;   // F-Left motor control pin 2
@@ -31,28 +42,86 @@ const int B_MOTOR_RIGHT_IN4 = 32; // B-Right motor control pin 2
 const int CENTER_ANGLE = 90;
 const int RIGHT_ANGLE = 120;
 const int LEFT_ANGLE = 60; 
-const int MOVEMENT_DELAY = 2000;
 
-bool motorsEnabled = false;
-bool servosEnabled = false;
-bool fullTestSuite = false;
+// Long enough for a servo to cross its whole range, well short of the old 2s delays
+const unsigned long SERVO_HOLD_MS = 400;
+const unsigned long MOTOR_RUN_MS = 1000;
+const unsigned long MOTOR_REST_MS = 500;
 
-void testServos() {
-  Serial.println("Testing front left servo");
-  frontLeftServo.write(CENTER_ANGLE);
-  delay(500);
-  
-  Serial.println("Testing front right servo");
-  frontRightServo.write(CENTER_ANGLE);
-  delay(500);
-  
-  Serial.println("Testing back left servo");
-  backLeftServo.write(CENTER_ANGLE);
-  delay(500);
-  
-  Serial.println("Testing back right servo");
-  backRightServo.write(CENTER_ANGLE);
-  delay(500);
+// One servo at a time, so a miswired or dead one is easy to spot
+const TestStep EACH_SERVO_STEPS[] = {
+  {ACT_SERVO_FRONT_LEFT, RIGHT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_FRONT_LEFT, CENTER_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_FRONT_RIGHT, RIGHT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_FRONT_RIGHT, CENTER_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_BACK_LEFT, RIGHT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_BACK_LEFT, CENTER_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_BACK_RIGHT, RIGHT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVO_BACK_RIGHT, CENTER_ANGLE, SERVO_HOLD_MS},
+};
+
+const TestStep STEERING_STEPS[] = {
+  {ACT_SERVOS, RIGHT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVOS, CENTER_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVOS, LEFT_ANGLE, SERVO_HOLD_MS},
+  {ACT_SERVOS, CENTER_ANGLE, SERVO_HOLD_MS},
+};
+
+const TestStep MOTOR_STEPS[] = {
+  {ACT_MOTORS, 1, MOTOR_RUN_MS},
+  {ACT_MOTORS, 0, MOTOR_REST_MS},
+  {ACT_MOTORS, -1, MOTOR_RUN_MS},
+  {ACT_MOTORS, 0, MOTOR_REST_MS},
+};
+
+#define SEQUENCE(name, steps) {name, steps, sizeof(steps) / sizeof(steps[0])}
+const TestSequence SEQUENCES[] = {
+  SEQUENCE("each", EACH_SERVO_STEPS),
+  SEQUENCE("steering", STEERING_STEPS),
+  SEQUENCE("motors", MOTOR_STEPS),
+};
+const int SEQUENCE_COUNT = sizeof(SEQUENCES) / sizeof(SEQUENCES[0]);
+
+const unsigned int SERIAL_LINE_MAX = 64;
+String serialLine = "";
+
+int centerFeedback = 0;
+int stepStartFeedback = 0;
+int stepStartAngle = 0;
+
+Servo* servoFor(Actuator actuator) {
+  switch (actuator) {
+    case ACT_SERVO_FRONT_LEFT: return &frontLeftServo;
+    case ACT_SERVO_FRONT_RIGHT: return &frontRightServo;
+    case ACT_SERVO_BACK_LEFT: return &backLeftServo;
+    case ACT_SERVO_BACK_RIGHT: return &backRightServo;
+    default: return nullptr;
+  }
+}
+
+// Only says the pulse is going out, read() just echoes the last write.
+// Whether the horn moved is checked from the wiper.
+bool writeServo(Servo& servo, int angle) {
+  if (!servo.attached()) {
+    return false;
+  }
+  servo.write(angle);
+  return true;
+}
+
+int readFeedback() {
+  long total = 0;
+  for (int i = 0; i < FEEDBACK_SAMPLES; i++) {
+    total += analogRead(SERVO_FEEDBACK_PIN);
+  }
+  return total / FEEDBACK_SAMPLES;
+}
+
+void centerServos() {
+  writeServo(frontLeftServo, CENTER_ANGLE);
+  writeServo(frontRightServo, CENTER_ANGLE);
+  writeServo(backLeftServo, CENTER_ANGLE);
+  writeServo(backRightServo, CENTER_ANGLE);
 }
 
 void stopMotors() {
@@ -92,6 +161,90 @@ void motorsForward() {
   digitalWrite(B_MOTOR_RIGHT_IN4, LOW);
 }
 
+void motorsBackward() {
+  // Front motors
+  digitalWrite(F_MOTOR_LEFT_IN1, LOW);
+  digitalWrite(F_MOTOR_LEFT_IN2, HIGH);
+  digitalWrite(F_MOTOR_RIGHT_IN3, LOW);
+  digitalWrite(F_MOTOR_RIGHT_IN4, HIGH);
+
+  // Middle motors
+  digitalWrite(M_MOTOR_LEFT_IN1, LOW);
+  digitalWrite(M_MOTOR_LEFT_IN2, HIGH);
+  digitalWrite(M_MOTOR_RIGHT_IN3, LOW);
+  digitalWrite(M_MOTOR_RIGHT_IN4, HIGH);
+
+  // Back motors
+  digitalWrite(B_MOTOR_LEFT_IN1, LOW);
+  digitalWrite(B_MOTOR_LEFT_IN2, HIGH);
+  digitalWrite(B_MOTOR_RIGHT_IN3, LOW);
+  digitalWrite(B_MOTOR_RIGHT_IN4, HIGH);
+}
+
+bool movesFrontLeft(Actuator actuator) {
+  return actuator == ACT_SERVO_FRONT_LEFT || actuator == ACT_SERVOS;
+}
+
+bool applyTestStep(const TestStep& step) {
+  if (movesFrontLeft(step.actuator)) {
+    stepStartAngle = frontLeftServo.read();
+    stepStartFeedback = readFeedback();
+  }
+  switch (step.actuator) {
+    case ACT_SERVOS: {
+      bool accepted = writeServo(frontLeftServo, step.target);
+      accepted &= writeServo(frontRightServo, step.target);
+      accepted &= writeServo(backLeftServo, step.target);
+      accepted &= writeServo(backRightServo, step.target);
+      return accepted;
+    }
+    case ACT_MOTORS:
+      if (step.target > 0) {
+        motorsForward();
+      } else if (step.target < 0) {
+        motorsBackward();
+      } else {
+        stopMotors();
+      }
+      return true;
+    case ACT_WAIT:
+      return true;
+    default:
+      return writeServo(*servoFor(step.actuator), step.target);
+  }
+}
+
+// Called once the hold is over, the servo has had its full swing time
+StepCheck checkFrontLeft(int target) {
+  int reading = readFeedback();
+  bool passed = target == CENTER_ANGLE
+                    ? abs(reading - centerFeedback) <= FEEDBACK_CENTER_BAND_COUNTS
+                    : abs(reading - stepStartFeedback) >= FEEDBACK_MIN_COUNTS_PER_DEGREE * abs(target - stepStartAngle);
+  Serial.printf("[Test]   front left feedback %d -> %d counts (centre %d)\n", stepStartFeedback, reading,
+                centerFeedback);
+  return passed ? CHECK_PASSED : CHECK_FAILED;
+}
+
+StepCheck checkTestStep(const TestStep& step) {
+  switch (step.actuator) {
+    case ACT_SERVO_FRONT_LEFT:
+      return checkFrontLeft(step.target);
+    case ACT_SERVOS:
+      // A good front left reading still leaves the other three unchecked
+      return checkFrontLeft(step.target) == CHECK_FAILED ? CHECK_FAILED : CHECK_UNVERIFIED;
+    case ACT_WAIT:
+      return CHECK_PASSED;
+    default:
+      return CHECK_UNVERIFIED;
+  }
+}
+
+// After every run, finished or aborted
+void safeState() {
+  stopMotors();
+  centerServos();
+}
+
 void setup() {
   Serial.begin(9600);
   Serial.println("Initialization...");
@@ -136,62 +289,41 @@ void setup() {
   stopMotors();
   Serial.println("Motor pins initialized");
   
-  // INDIVIDUAL SERVO TESTS
-  Serial.println("Testing servos...");
-  testServos();
-  
-  // DISABLE MOTORS FOR SAFETY
-  motorsEnabled = false;
-  servosEnabled = false;
-  fullTestSuite = false;
-  Serial.println("Initialization complete. Tests disabled for safety.");
+  centerServos();
+  delay(SERVO_HOLD_MS);
+  centerFeedback = readFeedback();
+  Serial.printf("Front left servo feedback at centre: %d counts\n", centerFeedback);
+  setupSequencer(SEQUENCES, SEQUENCE_COUNT, applyTestStep, checkTestStep, safeState);
+  Serial.println("Initialization complete. Nothing runs until a sequence is started.");
+  listSequences();
 }
 
-void loop() {
-  // COMMENT OUT TO ENABLE DIFFERENT TESTS TESTS
-  // motorsEnabled = true;
-  // servosEnabled = true;
-  fullTestSuite = true;
-  if(servosEnabled || fullTestSuite) {
-    // Turn servos right
-    Serial.println("Turning right");
-    frontLeftServo.write(RIGHT_ANGLE);
-    frontRightServo.write(RIGHT_ANGLE);
-    backLeftServo.write(RIGHT_ANGLE);
-    backRightServo.write(RIGHT_ANGLE);
-    delay(MOVEMENT_DELAY);
-    
-    // Center servos
-    Serial.println("Centering");
-    frontLeftServo.write(CENTER_ANGLE);
-    frontRightServo.write(CENTER_ANGLE);
-    backLeftServo.write(CENTER_ANGLE);
-    backRightServo.write(CENTER_ANGLE);
-    delay(MOVEMENT_DELAY);
-    
-    // Turn servos left
-    Serial.println("Turning left");
-    frontLeftServo.write(LEFT_ANGLE);
-    frontRightServo.write(LEFT_ANGLE);
-    backLeftServo.write(LEFT_ANGLE);
-    backRightServo.write(LEFT_ANGLE);
-    delay(MOVEMENT_DELAY);
-    
-    // Center servos
-    Serial.println("Centering");
-    frontLeftServo.write(CENTER_ANGLE);
-    frontRightServo.write(CENTER_ANGLE);
-    backLeftServo.write(CENTER_ANGLE);
-    backRightServo.write(CENTER_ANGLE);
-    delay(MOVEMENT_DELAY);
+// Input builds up a byte at a time, so a line without its newline yet never
+// holds up the sequencer the way readStringUntil's timeout would
+void handleSerialCommand(String input) {
+  input.trim();
+  if (input == "list") {
+    listSequences();
+  } else if (input == "abort") {
+    abortSequence();
+  } else if (input.startsWith("run ")) {
+    startSequence(input.substring(4));
   }
-  if (motorsEnabled || fullTestSuite) {
-    Serial.println("Testing motors forward");
-    motorsForward();
-    delay(1000);
-    
-    Serial.println("Stopping motors");
-    stopMotors();
-    delay(2000);
+}
+
+void processSerialCommands() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\n') {
+      handleSerialCommand(serialLine);
+      serialLine = "";
+    } else if (serialLine.length() < SERIAL_LINE_MAX) {
+      serialLine += c;
+    }
   }
-}
\ No newline at end of file
+}
+
+void loop() {
+  processSerialCommands();
+  updateSequencer();
+}
@@ -0,0 +1,140 @@
+#include "testSequencer.h"
+
+const TestSequence* sequenceTable = nullptr;
+int sequenceTableSize = 0;
+StepAction applyStep = nullptr;
+CheckAction checkStep = nullptr;
+SafeStateAction enterSafeState = nullptr;
+
+// Sequence and step being run, -1 when idle
+int activeSequence = -1;
+int activeStep = 0;
+bool runAll = false;
+unsigned long stepStartMs = 0;
+unsigned long stepApplyUs = 0;
+bool stepAccepted = false;
+
+unsigned long runStartMs = 0;
+int stepsPassed = 0;
+int stepsUnverified = 0;
+int stepsRun = 0;
+
+const char* actuatorName(Actuator actuator) {
+  switch (actuator) {
+    case ACT_SERVO_FRONT_LEFT: return "front left servo";
+    case ACT_SERVO_FRONT_RIGHT: return "front right servo";
+    case ACT_SERVO_BACK_LEFT: return "back left servo";
+    case ACT_SERVO_BACK_RIGHT: return "back right servo";
+    case ACT_SERVOS: return "all servos";
+    case ACT_MOTORS: return "motors";
+    case ACT_WAIT: return "wait";
+  }
+  return "?";
+}
+
+void setupSequencer(const TestSequence* sequences, int count, StepAction apply, CheckAction check,
+                    SafeStateAction safeState) {
+  sequenceTable = sequences;
+  sequenceTableSize = count;
+  applyStep = apply;
+  checkStep = check;
+  enterSafeState = safeState;
+}
+
+void beginStep() {
+  const TestStep& step = sequenceTable[activeSequence].steps[activeStep];
+  unsigned long start = micros();
+  stepAccepted = applyStep(step);
+  stepApplyUs = micros() - start;
+  stepStartMs = millis();
+  Serial.printf("[Test] t=%lu %s %d/%d: %s -> %d, hold %lu ms\n", stepStartMs, sequenceTable[activeSequence].name,
+                activeStep + 1, sequenceTable[activeSequence].stepCount, actuatorName(step.actuator), step.target,
+                step.holdMs);
+}
+
+void beginSequence(int index) {
+  activeSequence = index;
+  activeStep = 0;
+  Serial.printf("[Test] t=%lu Running %s\n", millis(), sequenceTable[index].name);
+  beginStep();
+}
+
+void finishRun(bool aborted) {
+  enterSafeState();
+  activeSequence = -1;
+  int stepsFailed = stepsRun - stepsPassed - stepsUnverified;
+  const char* verdict = aborted ? "ABORTED" : stepsFailed ? "FAIL" : stepsUnverified ? "UNVERIFIED" : "PASS";
+  Serial.printf("[Test] t=%lu %s: %d/%d steps passed, %d unverified, %d failed in %lu ms\n", millis(), verdict,
+                stepsPassed, stepsRun, stepsUnverified, stepsFailed, millis() - runStartMs);
+}
+
+bool startSequence(const String& name) {
+  if (sequencerBusy()) {
+    Serial.println("[Test] Already running, \"abort\" first");
+    return false;
+  }
+  runAll = name == "all";
+  for (int i = 0; i < sequenceTableSize; i++) {
+    if (runAll || name == sequenceTable[i].name) {
+      runStartMs = millis();
+      stepsPassed = 0;
+      stepsUnverified = 0;
+      stepsRun = 0;
+      beginSequence(i);
+      return true;
+    }
+  }
+  Serial.println("[Test] No sequence called " + name);
+  return false;
+}
+
+void abortSequence() {
+  if (sequencerBusy()) {
+    finishRun(true);
+  }
+}
+
+bool sequencerBusy() {
+  return activeSequence >= 0;
+}
+
+void updateSequencer() {
+  if (!sequencerBusy()) {
+    return;
+  }
+  const TestStep& step = sequenceTable[activeSequence].steps[activeStep];
+  unsigned long heldMs = millis() - stepStartMs;
+  if (heldMs < step.holdMs) {
+    return;
+  }
+
+  bool onTime = heldMs - step.holdMs <= HOLD_TOLERANCE_MS;
+  StepCheck check = stepAccepted ? checkStep(step) : CHECK_FAILED;
+  bool failed = !stepAccepted || !onTime || check == CHECK_FAILED;
+  stepsRun++;
+  stepsPassed += !failed && check == CHECK_PASSED;
+  stepsUnverified += !failed && check == CHECK_UNVERIFIED;
+  const char* result = failed ? "FAIL" : check == CHECK_UNVERIFIED ? "UNVERIFIED" : "pass";
+  Serial.printf("[Test] t=%lu   %s: applied in %lu us, held %lu ms%s%s%s\n", millis(), result, stepApplyUs, heldMs,
+                stepAccepted ? "" : ", target refused", onTime ? "" : ", hold overran",
+                stepAccepted && check == CHECK_FAILED ? ", feedback disagrees" : "");
+
+  if (++activeStep < sequenceTable[activeSequence].stepCount) {
+    beginStep();
+  } else if (runAll && activeSequence + 1 < sequenceTableSize) {
+    beginSequence(activeSequence + 1);
+  } else {
+    finishRun(false);
+  }
+}
+
+void listSequences() {
+  for (int i = 0; i < sequenceTableSize; i++) {
+    unsigned long totalMs = 0;
+    for (int s = 0; s < sequenceTable[i].stepCount; s++) {
+      totalMs += sequenceTable[i].steps[s].holdMs;
+    }
+    Serial.printf("[Test] %s: %d steps, %lu ms\n", sequenceTable[i].name, sequenceTable[i].stepCount, totalMs);
+  }
+  Serial.println("[Test] run <name> | run all | abort | list");
+}
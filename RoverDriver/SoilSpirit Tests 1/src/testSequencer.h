@@ -0,0 +1,61 @@
+#ifndef TEST_SEQUENCER_H
+#define TEST_SEQUENCER_H
+
+#include <Arduino.h>
+
+enum Actuator : uint8_t {
+  ACT_SERVO_FRONT_LEFT,
+  ACT_SERVO_FRONT_RIGHT,
+  ACT_SERVO_BACK_LEFT,
+  ACT_SERVO_BACK_RIGHT,
+  ACT_SERVOS,   // all four to the same angle
+  ACT_MOTORS,   // target 1 forward, 0 stop, -1 backward
+  ACT_WAIT,     // hold only
+};
+
+// Drive one actuator to target, then hold for holdMs before the next step
+struct TestStep {
+  Actuator actuator;
+  int target;
+  unsigned long holdMs;
+};
+
+struct TestSequence {
+  const char* name;
+  const TestStep* steps;
+  int stepCount;
+};
+
+// What the hardware showed at the end of a step's hold. Only actuators with
+// feedback can pass or fail; the rest are UNVERIFIED, never a silent pass.
+enum StepCheck : uint8_t {
+  CHECK_PASSED,
+  CHECK_FAILED,
+  CHECK_UNVERIFIED,
+};
+
+// A step fails when the actuator refuses its target, its check fails, or the
+// hold ends more than HOLD_TOLERANCE_MS late, i.e. something blocked the loop
+const unsigned long HOLD_TOLERANCE_MS = 20;
+
+// Applies a step to the hardware, false if the actuator didn't take the target
+typedef bool (*StepAction)(const TestStep& step);
+// Reads back the result once the hold is over
+typedef StepCheck (*CheckAction)(const TestStep& step);
+typedef void (*SafeStateAction)();
+
+void setupSequencer(const TestSequence* sequences, int count, StepAction apply, CheckAction check,
+                    SafeStateAction safeState);
+
+// "all" queues every sequence in turn
+bool startSequence(const String& name);
+void abortSequence();
+bool sequencerBusy();
+
+// Call every loop(), never blocks
+void updateSequencer();
+
+void listSequences();
+const char* actuatorName(Actuator actuator);
+
+#endif //TEST_SEQUENCER_H
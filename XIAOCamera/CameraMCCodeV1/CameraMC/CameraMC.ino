@@ -5,16 +5,49 @@
 #include <WiFi.h>
 #include "esp_camera.h"
 #include "apiServer.h"
+#include "udpServer.h"
+#include "uartLink.h"
+#include "base64Encoder.h"
 
 #define CAMERA_MODEL_XIAO_ESP32S3
 
 #include "camera_pins.h"
 #include "secrets.h"
 
+// Uncomment to time the base64 encoders on a frame of every size we run at
+// #define BASE64_BENCHMARK
+// Uncomment to compare the buffered and streaming response parsers at boot
+// #define PARSER_BENCHMARK
+
+#ifdef BASE64_BENCHMARK
+void benchmarkFramesizes(sensor_t* s) {
+  const framesize_t sizes[] = {FRAMESIZE_240X240, FRAMESIZE_QVGA, FRAMESIZE_SVGA, FRAMESIZE_UXGA};
+  const char* names[] = {"240X240", "QVGA", "SVGA", "UXGA"};
+  for (int i = 0; i < 4; i++) {
+    s->set_framesize(s, sizes[i]);
+    // The frame already queued is still the old size
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb) {
+      esp_camera_fb_return(fb);
+    }
+    fb = esp_camera_fb_get();
+    if (!fb) {
+      Serial.printf("[Base64] %s: capture failed\n", names[i]);
+      continue;
+    }
+    benchmarkBase64(fb->buf, fb->len, names[i]);
+    esp_camera_fb_return(fb);
+  }
+}
+#endif
+
 void setup() {
   Serial.begin(115200);
   Serial.setDebugOutput(true);
   Serial.println();
+#ifdef PARSER_BENCHMARK
+  benchmarkResponseParsers();
+#endif
 
   camera_config_t config;
   config.ledc_channel = LEDC_CHANNEL_0;
@@ -78,7 +111,13 @@ void setup() {
   }
   // drop down frame size for higher initial frame rate
   if(config.pixel_format == PIXFORMAT_JPEG){
-    s->set_framesize(s, FRAMESIZE_QVGA);
+#ifdef BASE64_BENCHMARK
+    benchmarkFramesizes(s);
+#endif
+    // The capture controller takes it from here
+    const CaptureSetting& initial = captureSetting(INITIAL_CAPTURE_LEVEL);
+    s->set_framesize(s, initial.framesize);
+    s->set_quality(s, initial.quality);
   }
 
   WiFi.begin(ssid, password);
@@ -90,13 +129,19 @@ void setup() {
   }
   Serial.println("");
   Serial.println("[Main] WiFi connected");
+  setupVisionPipeline();
   setupApiServer();
+  setupUdpServer();
+  setupUartLink();
 }
 
 void loop() {
   // processSerialCommands();
   handleAPIServer(); 
-  delay(100);
+  handleUdpServer();
+  handleUartLink();
+  // Short enough that the UART ack lands well inside the rover's timeout
+  delay(10);
 }
 
 #endif //CAMERAMC
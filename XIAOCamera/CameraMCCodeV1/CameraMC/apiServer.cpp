@@ -1,48 +1,65 @@
 #include "apiServer.h"
 
 WebServer server(80); //Web server on port 80
-String lastCommand = "";
-
-String captureAndAnalyzeImage() {
-  Serial.println("[Camera] Capturing image...");
-
-  // Capture the image frame buffer
-  camera_fb_t* fb = esp_camera_fb_get();
-  if (!fb) {
-    Serial.println("[Camera] Camera capture failed");
-    return "Capture Error";
-  }
-
-  Serial.println("[Camera] Image captured");
-  String base64Image = encodeImageToBase64(fb->buf, fb->len); //Convert image to base64
-
-  // Return the frame buffer after processing the image
-  esp_camera_fb_return(fb); 
-
-  if (base64Image.isEmpty()) {
-    Serial.println("Failed to encode the image!");
-    return "Encode Error";
-  }
-  return analyzeImageWithClaude(base64Image, lastCommand);
-}
 
 void handleRoot() {
     if (server.hasArg("lastCommand")) { //check for lastCommand query param
         // Get the query parameter value
         String commandParam = server.arg("lastCommand");
-        lastCommand = commandParam;
-        String command = captureAndAnalyzeImage();
+        RoverTelemetry telemetry;
+        bool hasTelemetry = server.hasArg("telemetry") && decodeTelemetry(server.arg("telemetry"), telemetry);
+        updateRoverState(commandParam, hasTelemetry ? &telemetry : nullptr);
+        // Answered from the cached decision, no waiting on the LLM
+        VisionDecision decision = serveDecision();
+        CommandStamp stamp = decisionStamp(decision);
+        server.sendHeader("X-Decision-Seq", String(decision.seq));
+        server.sendHeader("X-Capture-Age", String(stamp.ageMs));
+        server.sendHeader("X-Valid-For", String(stamp.validForMs));
+        if (decision.hasObstacles) {
+            server.sendHeader("X-Obstacles", encodeObstacles(decision.obstacles));
+        }
         Serial.println("[Server] Sent Command");
-        server.send(200, "text/plain", command);
+        server.send(200, "text/plain", decision.command);
     } else {
         server.send(200, "text/plain", "Incorrect Query Params");
     }
 }
 
 
+void handleStats() {
+  server.send(200, "text/plain", pipelineStatsText() + regionStatsText());
+}
+
+// /roi?top=0.4 changes the uploaded region, missing sides stay as they are; /roi?full=1 uploads whole frames
+void handleRoi() {
+  RegionOfInterest region = regionOfInterest();
+  if (server.hasArg("full")) {
+    region = FULL_FRAME;
+  }
+  if (server.hasArg("left")) {
+    region.left = server.arg("left").toFloat();
+  }
+  if (server.hasArg("top")) {
+    region.top = server.arg("top").toFloat();
+  }
+  if (server.hasArg("right")) {
+    region.right = server.arg("right").toFloat();
+  }
+  if (server.hasArg("bottom")) {
+    region.bottom = server.arg("bottom").toFloat();
+  }
+  if (!setRegionOfInterest(region)) {
+    server.send(400, "text/plain", "Region too small");
+    return;
+  }
+  server.send(200, "text/plain", regionStatsText());
+}
+
 void setupApiServer() {
   // Define server routes
   server.on("/", HTTP_GET, handleRoot);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/roi", HTTP_GET, handleRoi);
 
   // Start the server
   server.begin();
@@ -4,13 +4,10 @@
 #include <WebServer.h>
 #include <Arduino.h>
 // #include <ESPmDNS.h>
-#include "claudeAPI.h"
-#include "esp_camera.h"
+#include "visionPipeline.h"
+#include "commandPacket.h"
 
-extern String lastCommand;
-
-String captureAndAnalyzeImage();
 void setupApiServer();
 void handleAPIServer();
 
-#endif //API_SERVER_H
\ No newline at end of file
+#endif //API_SERVER_H
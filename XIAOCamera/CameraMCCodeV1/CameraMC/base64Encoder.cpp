@@ -0,0 +1,135 @@
+#include "base64Encoder.h"
+#include <Base64.h>
+
+const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Both characters for every 12-bit half of a group, so a group is two lookups
+// instead of four shift-and-mask steps
+char digitPairs[4096][2];
+bool digitPairsReady = false;
+
+void buildDigitPairs() {
+  for (int i = 0; i < 4096; i++) {
+    digitPairs[i][0] = BASE64_DIGITS[i >> 6];
+    digitPairs[i][1] = BASE64_DIGITS[i & 0x3F];
+  }
+  digitPairsReady = true;
+}
+
+inline uint32_t loadBigEndian(const uint8_t* data) {
+  uint32_t word;
+  memcpy(&word, data, 4);
+  return __builtin_bswap32(word);
+}
+
+inline void storeGroup(uint32_t bits, char* out) {
+  memcpy(out, digitPairs[(bits >> 12) & 0xFFF], 2);
+  memcpy(out + 2, digitPairs[bits & 0xFFF], 2);
+}
+
+void base64EncodeGroups(const uint8_t* data, size_t groups, char* out) {
+  if (!digitPairsReady) {
+    buildDigitPairs();
+  }
+  // Four groups at a time from three 32-bit loads
+  while (groups >= 4) {
+    uint32_t a = loadBigEndian(data);
+    uint32_t b = loadBigEndian(data + 4);
+    uint32_t c = loadBigEndian(data + 8);
+    storeGroup(a >> 8, out);
+    storeGroup((a << 16) | (b >> 16), out + 4);
+    storeGroup((b << 8) | (c >> 24), out + 8);
+    storeGroup(c, out + 12);
+    data += 12;
+    out += 16;
+    groups -= 4;
+  }
+  while (groups > 0) {
+    storeGroup((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2], out);
+    data += 3;
+    out += 4;
+    groups--;
+  }
+}
+
+void base64EncodeTail(const uint8_t* data, size_t length, char* out) {
+  uint32_t bits = (uint32_t)data[0] << 16;
+  if (length > 1) {
+    bits |= (uint32_t)data[1] << 8;
+  }
+  if (length > 2) {
+    bits |= data[2];
+  }
+  out[0] = BASE64_DIGITS[(bits >> 18) & 0x3F];
+  out[1] = BASE64_DIGITS[(bits >> 12) & 0x3F];
+  out[2] = length > 1 ? BASE64_DIGITS[(bits >> 6) & 0x3F] : '=';
+  out[3] = length > 2 ? BASE64_DIGITS[bits & 0x3F] : '=';
+}
+
+size_t Base64Encoder::update(const uint8_t* data, size_t length, char* out) {
+  size_t written = 0;
+  // Complete the group left over from the last piece first
+  if (pendingCount > 0) {
+    if (pendingCount + length < 3) {
+      memcpy(pending + pendingCount, data, length);
+      pendingCount += length;
+      return 0;
+    }
+    uint8_t group[3];
+    memcpy(group, pending, pendingCount);
+    memcpy(group + pendingCount, data, 3 - pendingCount);
+    data += 3 - pendingCount;
+    length -= 3 - pendingCount;
+    pendingCount = 0;
+    base64EncodeGroups(group, 1, out);
+    written = 4;
+  }
+  size_t groups = length / 3;
+  base64EncodeGroups(data, groups, out + written);
+  written += groups * 4;
+  pendingCount = length - groups * 3;
+  memcpy(pending, data + groups * 3, pendingCount);
+  return written;
+}
+
+size_t Base64Encoder::finish(char* out) {
+  if (pendingCount == 0) {
+    return 0;
+  }
+  base64EncodeTail(pending, pendingCount, out);
+  pendingCount = 0;
+  return 4;
+}
+
+void benchmarkBase64(const uint8_t* data, size_t length, const char* label) {
+  const int RUNS = 5;
+  char* out = (char*)malloc(base64EncodedLength(length));
+  if (!out) {
+    Serial.printf("[Base64] %s: no memory for %u bytes\n", label, (unsigned)base64EncodedLength(length));
+    return;
+  }
+
+  unsigned long start = micros();
+  size_t legacyLength = 0;
+  for (int i = 0; i < RUNS; i++) {
+    legacyLength = base64::encode(data, length).length();
+  }
+  unsigned long legacyUs = (micros() - start) / RUNS;
+
+  start = micros();
+  size_t encodedLength = 0;
+  for (int i = 0; i < RUNS; i++) {
+    Base64Encoder encoder;
+    encodedLength = encoder.update(data, length, out);
+    encodedLength += encoder.finish(out + encodedLength);
+  }
+  unsigned long wordUs = (micros() - start) / RUNS;
+
+  String reference = base64::encode(data, length);
+  bool matches = encodedLength == legacyLength && memcmp(out, reference.c_str(), encodedLength) == 0;
+  free(out);
+
+  Serial.printf("[Base64] %s: %u bytes, base64::encode %lu us (%.1f MB/s), word-at-a-time %lu us (%.1f MB/s)%s\n",
+                label, (unsigned)length, legacyUs, legacyUs ? (float)length / legacyUs : 0.0f, wordUs,
+                wordUs ? (float)length / wordUs : 0.0f, matches ? "" : " MISMATCH");
+}
@@ -0,0 +1,34 @@
+#ifndef BASE64_ENCODER_H
+#define BASE64_ENCODER_H
+
+#include <Arduino.h>
+
+inline size_t base64EncodedLength(size_t bytes) {
+  return (bytes + 2) / 3 * 4;
+}
+
+// Encodes groups whole 3-byte groups of data into groups * 4 characters
+void base64EncodeGroups(const uint8_t* data, size_t groups, char* out);
+
+// The last 1-3 bytes of data, padded to four characters
+void base64EncodeTail(const uint8_t* data, size_t length, char* out);
+
+// Encodes a buffer that arrives in pieces. Up to two bytes of each piece are
+// held back until the next update() or finish(), so the output is the same as
+// encoding everything at once.
+class Base64Encoder {
+public:
+  // out needs room for base64EncodedLength(length) characters; returns how many were written
+  size_t update(const uint8_t* data, size_t length, char* out);
+  // Writes the padded last group, at most 4 characters, and resets the encoder
+  size_t finish(char* out);
+
+private:
+  uint8_t pending[2];
+  size_t pendingCount = 0;
+};
+
+// Times base64::encode against the word-at-a-time encoder on one frame
+void benchmarkBase64(const uint8_t* data, size_t length, const char* label);
+
+#endif //BASE64_ENCODER_H
@@ -0,0 +1,88 @@
+#include "captureController.h"
+#include "base64Encoder.h"
+#include "claudeAPI.h"
+#include "regionOfInterest.h"
+
+// Request time comes from the inference task, everything else is the capture task's.
+// A request time of 0 means none has come in at the current setting yet.
+portMUX_TYPE requestTimeMux = portMUX_INITIALIZER_UNLOCKED;
+float smoothedRequestMs = 0;
+
+int captureLevel = INITIAL_CAPTURE_LEVEL;
+// Nothing applied yet, so the first capture sets up the region too
+int appliedLevel = -1;
+float appliedKeptArea = 1.0;
+float smoothedJpegBytes = 0;
+int framesWithHeadroom = 0;
+// The first frame after a change can still be at the old setting
+bool settling = false;
+
+int applyCaptureSetting(sensor_t* sensor, float& keptArea) {
+  if (captureLevel != appliedLevel || regionChanged()) {
+    const CaptureSetting& setting = CAPTURE_LADDER[captureLevel];
+    appliedKeptArea = applyFramesize(sensor, setting.framesize);
+    sensor->set_quality(sensor, setting.quality);
+    appliedLevel = captureLevel;
+    settling = true;
+    smoothedJpegBytes = 0;
+    framesWithHeadroom = 0;
+    // Request times at the old setting say nothing about this one
+    portENTER_CRITICAL(&requestTimeMux);
+    smoothedRequestMs = 0;
+    portEXIT_CRITICAL(&requestTimeMux);
+    Serial.printf("[Capture] Switched to %s\n", setting.name);
+  }
+  keptArea = appliedKeptArea;
+  return appliedLevel;
+}
+
+void stepDown() {
+  if (captureLevel > 0) {
+    captureLevel--;
+  }
+}
+
+bool recordFrameSize(int level, size_t jpegBytes) {
+  if (base64EncodedLength(jpegBytes) > MAX_IMAGE_BASE64_BYTES) {
+    Serial.printf("[Capture] %u byte frame is over the API cap, dropping it\n", (unsigned)jpegBytes);
+    stepDown();
+    return false;
+  }
+  if (settling) {
+    settling = false;
+    return true;
+  }
+  if (level != captureLevel) {
+    return true;
+  }
+
+  smoothedJpegBytes = smoothedJpegBytes == 0 ? jpegBytes : smoothedJpegBytes * 0.7 + jpegBytes * 0.3;
+  portENTER_CRITICAL(&requestTimeMux);
+  float requestMs = smoothedRequestMs;
+  portEXIT_CRITICAL(&requestTimeMux);
+
+  if (smoothedJpegBytes > TARGET_JPEG_BYTES * 1.25 || requestMs > TARGET_REQUEST_MS * 1.2) {
+    stepDown();
+    return true;
+  }
+  // Stepping up roughly doubles the payload, so only with plenty of room on both
+  bool headroom = smoothedJpegBytes < TARGET_JPEG_BYTES * 0.5 && requestMs > 0 && requestMs < TARGET_REQUEST_MS * 0.8;
+  framesWithHeadroom = headroom ? framesWithHeadroom + 1 : 0;
+  if (framesWithHeadroom >= STEP_UP_FRAMES && captureLevel < CAPTURE_LEVELS - 1) {
+    captureLevel++;
+  }
+  return true;
+}
+
+void recordRequestTime(int level, unsigned long requestMs) {
+  if (level != appliedLevel) {
+    return;
+  }
+  portENTER_CRITICAL(&requestTimeMux);
+  smoothedRequestMs = smoothedRequestMs == 0 ? requestMs : smoothedRequestMs * 0.7 + requestMs * 0.3;
+  portEXIT_CRITICAL(&requestTimeMux);
+}
+
+const CaptureSetting& captureSetting(int level) {
+  return CAPTURE_LADDER[level];
+}
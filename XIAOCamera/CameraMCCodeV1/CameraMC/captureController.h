@@ -0,0 +1,46 @@
+#ifndef CAPTURE_CONTROLLER_H
+#define CAPTURE_CONTROLLER_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+struct CaptureSetting {
+  framesize_t framesize;
+  int quality;   // JPEG quantizer, lower is better
+  const char* name;
+};
+
+// Ordered by how big a frame comes out
+const CaptureSetting CAPTURE_LADDER[] = {
+  {FRAMESIZE_QQVGA, 20, "QQVGA q20"},
+  {FRAMESIZE_QVGA, 20, "QVGA q20"},
+  {FRAMESIZE_QVGA, 10, "QVGA q10"},
+  {FRAMESIZE_VGA, 20, "VGA q20"},
+  {FRAMESIZE_VGA, 12, "VGA q12"},
+  {FRAMESIZE_SVGA, 12, "SVGA q12"},
+  {FRAMESIZE_XGA, 12, "XGA q12"},
+};
+const int CAPTURE_LEVELS = sizeof(CAPTURE_LADDER) / sizeof(CAPTURE_LADDER[0]);
+// What the camera is set to at boot
+const int INITIAL_CAPTURE_LEVEL = 2;
+
+const size_t TARGET_JPEG_BYTES = 24000;
+// Upload plus inference, per request
+const unsigned long TARGET_REQUEST_MS = 2500;
+// Frames that must all leave headroom before stepping up a level
+const int STEP_UP_FRAMES = 8;
+
+// Applies the current level and region of interest to the sensor if either
+// changed. Called from the capture task before each frame; returns the level
+// the frame is taken at and the fraction of the full frame it covers.
+int applyCaptureSetting(sensor_t* sensor, float& keptArea);
+
+// Feedback from a captured frame. Returns false if the frame is over the
+// API's image cap and must not be sent.
+bool recordFrameSize(int level, size_t jpegBytes);
+// Feedback from a finished request on a frame taken at level
+void recordRequestTime(int level, unsigned long requestMs);
+
+const CaptureSetting& captureSetting(int level);
+
+#endif //CAPTURE_CONTROLLER_H
@@ -1,20 +1,32 @@
 #include "claudeAPI.h"
 
-String Prompt = "Given this image, identify possible obstacles and provide your analysis in the following JSON format only: { 'obstacles': [ { 'position': 'LEFT|MIDDLE|RIGHT', 'distance': 'CLOSE|MEDIUM|FAR', 'description': 'brief description' } ], 'command': 'FORWARD|FULL_STOP|TURN_LEFT|TURN_RIGHT', 'reasoning': 'brief explanation for the command'} Do not include any text outside of this JSON structure. Base your command on the horizontal position, distance, tracked obstacles, and passed in last command. Keep on path and ignore background and grass/plants.";
+String Prompt = "Given this image, identify possible obstacles and provide your analysis in the following JSON format only, with the command first: { 'command': 'FORWARD|FULL_STOP|TURN_LEFT|TURN_RIGHT', 'obstacles': [ { 'position': 'LEFT|MIDDLE|RIGHT', 'distance': 'CLOSE|MEDIUM|FAR', 'description': 'brief description' } ], 'reasoning': 'brief explanation for the command'} Do not include any text outside of this JSON structure. Base your command on the horizontal position, distance, tracked obstacles, and passed in last command. Keep on path and ignore background and grass/plants.";
 const String claudeAPIKey = CLAUDE_API_KEY;
 
-String analyzeImageWithClaude(const String& base64Image, const String& lastCommand) {
-  Serial.println("Sending image for analysis to Claude LLM...");
-  String imageMedia = "data:image/jpeg;base64," + base64Image;
-  
-  // Calculate the payload size with added buffer for json
-  int payloadSize = base64Image.length() + 2000;
-  DynamicJsonDocument doc(payloadSize > 16384 ? 16384 : payloadSize);
-  
+String describeTelemetry(const RoverTelemetry& telemetry) {
+  char description[160];
+  snprintf(description, sizeof(description),
+           "last maneuver %d%% complete, heading %.1f deg, position %d cm right and %d cm forward of start",
+           telemetry.progress * 100 / 255, telemetry.headingDeciDeg / 10.0, telemetry.poseXCm, telemetry.poseYCm);
+  return String(description);
+}
+
+String buildPromptText(const String& lastCommand, const RoverTelemetry* telemetry) {
+  String promptText = Prompt + "########## LAST COMMAND: " + lastCommand;
+  if (telemetry) {
+    promptText += "########## ROVER STATE: " + describeTelemetry(*telemetry);
+  }
+  return promptText;
+}
+
+// Everything but the image bytes, source.data is left empty
+void buildRequestDocument(JsonDocument& doc, const String& promptText) {
   // Claude Params
   doc["model"] = "claude-3-opus-20240229";
   doc["max_tokens"] = 1000;
   doc["temperature"] = 0.5;
+  // Server-sent events, so the command can be acted on before the reply finishes
+  doc["stream"] = true;
 
   // Message Array
   JsonArray messages = doc.createNestedArray("messages");
@@ -27,7 +39,7 @@ String analyzeImageWithClaude(const String& base64Image, const String& lastComma
   // Add Prompt
   JsonObject textPart = content.createNestedObject();
   textPart["type"] = "text";
-  textPart["text"] = Prompt + "########## LAST COMMAND: " + lastCommand;
+  textPart["text"] = promptText;
   
   // Add Base64 Image
   JsonObject imagePart = content.createNestedObject();
@@ -35,85 +47,266 @@ String analyzeImageWithClaude(const String& base64Image, const String& lastComma
   JsonObject source = imagePart.createNestedObject("source");
   source["type"] = "base64";
   source["media_type"] = "image/jpeg";
-  source["data"] = base64Image;
-  
-  // Serialize to string
-  String jsonPayload;
-  serializeJson(doc, jsonPayload);
-  
-  String result;
-  
-  // Check payload size
-  if (jsonPayload.length() > 100000) {
+  source["data"] = "";
+}
+
+// Splits the serialized envelope around the empty image data string, so the
+// base64 can go between the two halves
+bool buildRequestEnvelope(const String& promptText, String& prefix, String& suffix) {
+  DynamicJsonDocument doc(2048 + promptText.length());
+  buildRequestDocument(doc, promptText);
+  String envelope;
+  serializeJson(doc, envelope);
+
+  const char* marker = "\"data\":\"";
+  int dataStart = envelope.indexOf(String(marker) + "\"");
+  if (doc.overflowed() || dataStart < 0) {
+    return false;
+  }
+  dataStart += strlen(marker);
+  prefix = envelope.substring(0, dataStart);
+  suffix = envelope.substring(dataStart);
+  return true;
+}
+
+VisionRequestStats requestStats;
+uint32_t requestCount = 0;
+
+void recordRequestStats(size_t bodyBytes, unsigned long buildMs, unsigned long requestMs, unsigned long uploadMs,
+                        uint32_t heapBefore, uint32_t lowestHeap, uint32_t largestBlock) {
+  requestStats.bodyBytes = bodyBytes;
+  requestStats.buildMs = buildMs;
+  requestStats.requestMs = requestMs;
+  requestStats.uploadMs = uploadMs;
+  requestStats.peakHeapBytes = heapBefore > lowestHeap ? heapBefore - lowestHeap : 0;
+  requestStats.largestFreeBlock = largestBlock;
+  requestCount++;
+  printVisionRequestStats();
+}
+
+VisionRequestStats lastVisionRequestStats() {
+  return requestStats;
+}
+
+void printVisionRequestStats() {
+#ifdef LEGACY_VISION_REQUEST
+  const char* builder = "buffered";
+#else
+  const char* builder = "streamed";
+#endif
+  Serial.printf("[LLM] %s request #%lu: body %u bytes, build %lu ms, upload %lu ms, request %lu ms\n", builder,
+                (unsigned long)requestCount, (unsigned)requestStats.bodyBytes, requestStats.buildMs,
+                requestStats.uploadMs, requestStats.requestMs);
+  Serial.printf("[LLM] Heap: request peak %lu bytes, largest block %lu, min free since boot %lu\n",
+                (unsigned long)requestStats.peakHeapBytes, (unsigned long)requestStats.largestFreeBlock,
+                (unsigned long)ESP.getMinFreeHeap());
+  printConnectionStats();
+}
+
+// Only a reply whose JSON closed counts, a cut off one may be missing obstacles
+bool commandFromReply(const ResponseParser& parser, String& command, ObstacleReport& obstacles) {
+  const VisionReply& reply = parser.reply();
+  Serial.printf("[LLM] Response parsed in %lu us over %u bytes\n", parser.parseUs(), (unsigned)parser.bytesRead());
+  if (!reply.hasCommand) {
+    Serial.println(reply.sawText ? "[LLM] No command in the reply" : "[LLM] No text in the response");
+    command = "[LLM] No command";
+    return false;
+  }
+  if (!parser.done()) {
+    Serial.println("[LLM] Reply ended before its JSON closed");
+    command = "[LLM] Reply cut short";
+    return false;
+  }
+  obstacles = reply.obstacles;
+  command = reply.command;
+  Serial.println("Sending Command: ");
+  Serial.println(command);
+  return true;
+}
+
+bool prepareVisionRequest(const String& lastCommand, const RoverTelemetry* telemetry, VisionRequest& request) {
+  unsigned long buildStart = millis();
+  bool built = buildRequestEnvelope(buildPromptText(lastCommand, telemetry), request.prefix, request.suffix);
+  request.buildMs = millis() - buildStart;
+  if (!built) {
+    Serial.println("Failed to build the request!");
+  }
+  return built;
+}
+
+bool analyzeImageWithClaude(const uint8_t* image, size_t imageLength, const VisionRequest& request, String& command,
+                            ObstacleReport& obstacles, CommandListener onCommand, void* context) {
+  Serial.println("Sending image for analysis to Claude LLM...");
+  obstacles.count = 0;
+  if ((imageLength + 2) / 3 * 4 > MAX_IMAGE_BASE64_BYTES) {
     Serial.println("ERROR: Payload exceeds limit. Reduce image size");
-    return "[Image] Error";
+    command = "[Image] Error";
+    return false;
   }
+
+  uint32_t heapBefore = freeHeapBytes();
+  ResponseParser parser(onCommand, context);
+  String error;
+  bool sent;
+
+#ifdef LEGACY_VISION_REQUEST
+  unsigned long buildStart = millis();
+  String base64Image = encodeImageToBase64(image, imageLength);
+  if (base64Image.isEmpty()) {
+    Serial.println("Failed to encode the image!");
+    command = "Encode Error";
+    return false;
+  }
+  String jsonPayload;
+  if (!jsonPayload.reserve(request.prefix.length() + base64Image.length() + request.suffix.length())) {
+    Serial.println("Failed to build the request!");
+    command = "Encode Error";
+    return false;
+  }
+  jsonPayload += request.prefix;
+  jsonPayload += base64Image;
+  jsonPayload += request.suffix;
+  uint32_t lowestHeap = freeHeapBytes();
+  uint32_t largestBlock = largestFreeBlock();
+  unsigned long buildMs = request.buildMs + millis() - buildStart;
   
   Serial.print("Payload size: ");
   Serial.println(jsonPayload.length());
   
+  unsigned long requestStart = millis();
+  sent = sendClaudeRequest(jsonPayload, parser, error);
+  lowestHeap = min(lowestHeap, freeHeapBytes());
+  size_t bodyBytes = jsonPayload.length();
+  unsigned long uploadMs = 0;
+#else
+  Base64BodyStream body(request.prefix, image, imageLength, request.suffix);
+  uint32_t largestBlock = largestFreeBlock();
+  unsigned long buildMs = request.buildMs;
+
+  Serial.print("Payload size: ");
+  Serial.println(body.totalLength());
+
+  unsigned long requestStart = millis();
+  sent = sendClaudeRequest(body, parser, error);
+  uint32_t lowestHeap = min(body.minFreeHeap(), freeHeapBytes());
+  size_t bodyBytes = body.totalLength();
+  unsigned long uploadMs = body.uploadMs();
+#endif
+  recordRequestStats(bodyBytes, buildMs, millis() - requestStart, uploadMs, heapBefore, lowestHeap, largestBlock);
+
   // Send the request to LLM API
-  if (sendClaudeRequest(jsonPayload, result)) {
-    Serial.println("[LLM] Response received");
-    
-    // Parse the response
-    DynamicJsonDocument responseDoc(8192);
-    DeserializationError error = deserializeJson(responseDoc, result);
-    
-    if (!error) {
-      String responseContent = responseDoc["content"][0]["text"].as<String>();
-      Serial.println("[LLM] Analysis result:");
-      Serial.println(responseContent);
-      
-      // Extract command
-      DynamicJsonDocument textDoc(4096);
-      DeserializationError textError = deserializeJson(textDoc, responseContent);
-      if (!textError && textDoc.containsKey("command")) {
-        String commandResp = textDoc["command"].as<String>();
-        Serial.println("Sending Command: ");
-        Serial.println(commandResp);
-        return commandResp;
-      }
-    } else {
-      Serial.print("[LLM] Parsing error: ");
-      Serial.println(error.c_str());
-      return error.c_str();
-    }
-  } else {
-    Serial.print("[LLM] API Request error: ");
-    Serial.println(result);
-    return result;
+  if (sent) {
+    return commandFromReply(parser, command, obstacles);
   }
+  Serial.print("[LLM] API Request error: ");
+  Serial.println(error);
+  command = error;
+  return false;
 }
 
-bool sendClaudeRequest(const String& payload, String& result) {
-  HTTPClient http;
-  http.begin("https://api.anthropic.com/v1/messages");
-  
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("anthropic-version", "2023-06-01");
-  http.addHeader("x-api-key", claudeAPIKey);
-  http.setTimeout(60000); // 60 second timeout
-  
-  int httpResponseCode = http.POST(payload);
+// Long-lived so the connection it holds survives between requests
+HTTPClient claudeHttp;
+
+bool beginClaudeRequest(bool& reused, String& error) {
+  if (!openClaudeConnection(reused)) {
+    error = "TLS connection to the API failed";
+    return false;
+  }
+  String url = String("https://") + CLAUDE_API_HOST + ":" + String(CLAUDE_API_PORT) + "/v1/messages";
+  claudeHttp.begin(claudeClient(), url);
+  claudeHttp.setReuse(true);
   
-  if (httpResponseCode > 0) {
-    result = http.getString();
+  claudeHttp.addHeader("Content-Type", "application/json");
+  claudeHttp.addHeader("anthropic-version", "2023-06-01");
+  claudeHttp.addHeader("x-api-key", claudeAPIKey);
+  claudeHttp.setTimeout(60000); // 60 second timeout
+  return true;
+}
+
+// The API can close an idle connection just as a request goes out on it.
+// That fails before any response, so the request is worth one retry on a new one.
+bool retryOnNewConnection(bool reused, int httpResponseCode) {
+  if (!reused || httpResponseCode > 0) {
+    return false;
+  }
+  Serial.println("[TLS] Reused connection was closed, retrying on a new one");
+  claudeHttp.end();
+  closeClaudeConnection();
+  return true;
+}
+
+// A successful response goes through the parser straight from the socket.
+// Anything else is read whole, it is short and worth logging.
+bool finishClaudeRequest(bool reused, unsigned long startMs, int httpResponseCode, ResponseParser& parser,
+                         String& error) {
+  if (httpResponseCode == HTTP_CODE_OK) {
+    // Reads to the end of the body even once the parser has what it needs. A
+    // streamed body arrives chunked as it is generated, and is parsed as it comes.
+    int written = claudeHttp.writeToStream(&parser);
+    if (written < 0) {
+      error = "Response read failed: " + HTTPClient::errorToString(written);
+      Serial.println("[LLM] " + error);
+      claudeHttp.end();
+      closeClaudeConnection();
+      return false;
+    }
+    recordClaudeRequest(reused, millis() - startMs);
+    Serial.println("[LLM] HTTP Response Code: " + String(httpResponseCode));
+    // Leaves the connection open unless the API asked to close it
+    claudeHttp.end();
+    return true;
+  } else if (httpResponseCode > 0) {
+    String body = claudeHttp.getString();
+    recordClaudeRequest(reused, millis() - startMs);
+    error = "HTTP request failed, response code: " + String(httpResponseCode);
     Serial.println("[LLM] HTTP Response Code: " + String(httpResponseCode));
-    
-    if (result.length() > 200) {
-      Serial.println("[LLM] Response Body (truncated): " + result.substring(0, 200) + "...");
+    if (body.length() > 200) {
+      Serial.println("[LLM] Response Body (truncated): " + body.substring(0, 200) + "...");
     } else {
-      Serial.println("[LLM] Response Body: " + result);
+      Serial.println("[LLM] Response Body: " + body);
     }
-    
-    http.end();
-    return true;
+    claudeHttp.end();
+    return false;
   } else {
-    result = "HTTP request failed, response code: " + String(httpResponseCode);
+    error = "HTTP request failed, response code: " + String(httpResponseCode);
     Serial.println("[LLM] Error Code: " + String(httpResponseCode));
-    Serial.println("[LLM] Error Message: " + http.errorToString(httpResponseCode));
-    http.end();
+    Serial.println("[LLM] Error Message: " + HTTPClient::errorToString(httpResponseCode));
+    claudeHttp.end();
+    closeClaudeConnection();
     return false;
   }
 }
+
+bool sendClaudeRequest(const String& payload, ResponseParser& parser, String& error) {
+  unsigned long start = millis();
+  bool reused;
+  if (!beginClaudeRequest(reused, error)) {
+    return false;
+  }
+  int httpResponseCode = claudeHttp.POST((uint8_t*)payload.c_str(), payload.length());
+  if (retryOnNewConnection(reused, httpResponseCode)) {
+    if (!beginClaudeRequest(reused, error)) {
+      return false;
+    }
+    httpResponseCode = claudeHttp.POST((uint8_t*)payload.c_str(), payload.length());
+  }
+  return finishClaudeRequest(reused, start, httpResponseCode, parser, error);
+}
+
+// HTTPClient reads the body through the stream in TCP-buffer sized chunks
+bool sendClaudeRequest(Base64BodyStream& body, ResponseParser& parser, String& error) {
+  unsigned long start = millis();
+  bool reused;
+  if (!beginClaudeRequest(reused, error)) {
+    return false;
+  }
+  int httpResponseCode = claudeHttp.sendRequest("POST", &body, body.totalLength());
+  if (retryOnNewConnection(reused, httpResponseCode)) {
+    if (!beginClaudeRequest(reused, error)) {
+      return false;
+    }
+    body.rewind();
+    httpResponseCode = claudeHttp.sendRequest("POST", &body, body.totalLength());
+  }
+  return finishClaudeRequest(reused, start, httpResponseCode, parser, error);
+}
@@ -6,8 +6,47 @@
 #include <ArduinoJson.h>
 #include "utils.h"
 #include "secrets.h"
+#include "commandPacket.h"
+#include "requestStream.h"
+#include "claudeConnection.h"
+#include "responseParser.h"
 
-String analyzeImageWithClaude(const String& base64Image, const String& lastCommand);
-bool sendClaudeRequest(const String& payload, String& result);
+// Uncomment to build the whole request body in RAM before sending, as before
+// the streamed body, to compare heap and time against it
+// #define LEGACY_VISION_REQUEST
 
-#endif //CLAUDE_API_H
\ No newline at end of file
+// The API rejects base64 images larger than this
+const size_t MAX_IMAGE_BASE64_BYTES = 5 * 1024 * 1024;
+
+struct VisionRequestStats {
+  size_t bodyBytes;
+  unsigned long buildMs;       // assembling the body before the request starts
+  unsigned long requestMs;     // connect if needed, send and read the response
+  unsigned long uploadMs;      // sending the body, not measured for the buffered body
+  uint32_t peakHeapBytes;      // free heap before the request minus the lowest seen during it
+  uint32_t largestFreeBlock;   // largest allocatable block once the body was built
+};
+
+// Request body around the image, built ahead of sending
+struct VisionRequest {
+  String prefix;
+  String suffix;
+  unsigned long buildMs;
+};
+
+// telemetry is the rover state reported with the poll, or nullptr if none was sent
+bool prepareVisionRequest(const String& lastCommand, const RoverTelemetry* telemetry, VisionRequest& request);
+// True once the reply was read to the end with a command in it, which comes
+// back through command with the obstacles the LLM listed; on failure command
+// holds the error. image must stay valid until this returns, the body is
+// encoded from it while it is sent. onCommand is called with context as soon
+// as the command has streamed in, while the rest of the reply is still being read.
+bool analyzeImageWithClaude(const uint8_t* image, size_t imageLength, const VisionRequest& request, String& command,
+                            ObstacleReport& obstacles, CommandListener onCommand = nullptr, void* context = nullptr);
+String describeTelemetry(const RoverTelemetry& telemetry);
+bool sendClaudeRequest(const String& payload, ResponseParser& parser, String& error);
+bool sendClaudeRequest(Base64BodyStream& body, ResponseParser& parser, String& error);
+VisionRequestStats lastVisionRequestStats();
+void printVisionRequestStats();
+
+#endif //CLAUDE_API_H
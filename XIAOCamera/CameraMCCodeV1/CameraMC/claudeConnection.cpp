@@ -0,0 +1,93 @@
+#include "claudeConnection.h"
+
+WiFiClientSecure tlsClient;
+bool tlsConfigured = false;
+unsigned long lastWarmAttemptMs = 0;
+
+uint32_t handshakes = 0;
+uint32_t failedHandshakes = 0;
+uint64_t totalHandshakeMs = 0;
+unsigned long worstHandshakeMs = 0;
+uint32_t reusedRequests = 0;
+uint64_t totalReusedMs = 0;
+uint32_t freshRequests = 0;
+uint64_t totalFreshMs = 0;
+
+WiFiClientSecure& claudeClient() {
+  if (!tlsConfigured) {
+    // Same as HTTPClient's own https client when no CA is given
+    tlsClient.setInsecure();
+    tlsConfigured = true;
+  }
+  return tlsClient;
+}
+
+bool handshake() {
+  WiFiClientSecure& client = claudeClient();
+  unsigned long start = millis();
+  bool connected = client.connect(CLAUDE_API_HOST, CLAUDE_API_PORT);
+  unsigned long ms = millis() - start;
+  if (!connected) {
+    failedHandshakes++;
+    Serial.printf("[TLS] Handshake with %s failed after %lu ms\n", CLAUDE_API_HOST, ms);
+    return false;
+  }
+  handshakes++;
+  totalHandshakeMs += ms;
+  worstHandshakeMs = max(worstHandshakeMs, ms);
+  Serial.printf("[TLS] Handshake with %s took %lu ms\n", CLAUDE_API_HOST, ms);
+  return true;
+}
+
+bool openClaudeConnection(bool& reused) {
+  reused = claudeClient().connected();
+  return reused || handshake();
+}
+
+void closeClaudeConnection() {
+  claudeClient().stop();
+}
+
+void warmClaudeConnection() {
+  lastWarmAttemptMs = millis();
+  bool reused;
+  openClaudeConnection(reused);
+}
+
+// Nothing should arrive between requests. Unread bytes are the API's close
+// notify or an idle timeout response, and the connection won't take another request.
+bool connectionAlive() {
+  WiFiClientSecure& client = claudeClient();
+  return client.connected() && client.available() == 0;
+}
+
+void maintainClaudeConnection() {
+  if (millis() - lastWarmAttemptMs < CONNECTION_REWARM_MS) {
+    return;
+  }
+  lastWarmAttemptMs = millis();
+  if (!connectionAlive()) {
+    Serial.println("[TLS] Connection closed while idle, re-warming");
+    closeClaudeConnection();
+    warmClaudeConnection();
+  }
+}
+
+void recordClaudeRequest(bool reused, unsigned long requestMs) {
+  if (reused) {
+    reusedRequests++;
+    totalReusedMs += requestMs;
+  } else {
+    freshRequests++;
+    totalFreshMs += requestMs;
+  }
+}
+
+void printConnectionStats() {
+  Serial.printf("[TLS] Handshakes %lu (%lu failed), mean %lu ms, worst %lu ms\n", (unsigned long)handshakes,
+                (unsigned long)failedHandshakes, (unsigned long)(handshakes ? totalHandshakeMs / handshakes : 0),
+                worstHandshakeMs);
+  Serial.printf("[TLS] Requests on a reused connection %lu, mean %lu ms; after a handshake %lu, mean %lu ms\n",
+                (unsigned long)reusedRequests, (unsigned long)(reusedRequests ? totalReusedMs / reusedRequests : 0),
+                (unsigned long)freshRequests, (unsigned long)(freshRequests ? totalFreshMs / freshRequests : 0));
+}
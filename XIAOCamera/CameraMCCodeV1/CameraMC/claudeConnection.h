@@ -0,0 +1,33 @@
+#ifndef CLAUDE_CONNECTION_H
+#define CLAUDE_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+// Point these at tools/mock-sse-server.js to time streamed replies offline
+const char* const CLAUDE_API_HOST = "api.anthropic.com";
+const uint16_t CLAUDE_API_PORT = 443;
+// How often an idle connection is probed and, if it dropped, re-opened. Also
+// the wait between attempts, so an unreachable API isn't retried every loop.
+const unsigned long CONNECTION_REWARM_MS = 30000;
+
+// The one TLS connection all vision requests go over. HTTPClient keeps it
+// open between requests as long as the API allows keep-alive.
+WiFiClientSecure& claudeClient();
+
+// Makes sure the connection is up, handshaking only if it dropped. reused is
+// set when an open connection was already there.
+bool openClaudeConnection(bool& reused);
+// Drops a connection that failed mid-request, so the next open handshakes again
+void closeClaudeConnection();
+
+// Handshakes ahead of the first request
+void warmClaudeConnection();
+// Called while idle: probes the connection on a timer and re-opens it if the
+// API closed it, however long it has been since the last request
+void maintainClaudeConnection();
+
+void recordClaudeRequest(bool reused, unsigned long requestMs);
+void printConnectionStats();
+
+#endif //CLAUDE_CONNECTION_H
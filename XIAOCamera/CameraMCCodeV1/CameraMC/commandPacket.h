@@ -0,0 +1,212 @@
+#ifndef COMMAND_PACKET_H
+#define COMMAND_PACKET_H
+
+#include <Arduino.h>
+
+// Datagram layout shared with the camera (XIAOCamera/.../commandPacket.h).
+// Keep both copies identical.
+const uint8_t PACKET_MAGIC = 0x5A;
+const uint16_t COMMAND_UDP_PORT = 4210;
+const int MAX_PACKET_PAYLOAD = 48;
+
+enum PacketType : uint8_t {
+  PACKET_REQUEST = 1,   // rover -> camera, last executed command and telemetry
+  PACKET_ACK = 2,       // either way, acknowledges seq
+  PACKET_COMMAND = 3,   // camera -> rover, stamped next command
+};
+
+struct __attribute__((packed)) PacketHeader {
+  uint8_t magic;
+  uint8_t type;
+  uint16_t seq;
+  uint8_t length;
+};
+
+struct __attribute__((packed)) CommandPacket {
+  PacketHeader header;
+  uint8_t payload[MAX_PACKET_PAYLOAD];
+};
+
+inline size_t buildPacket(CommandPacket& packet, PacketType type, uint16_t seq, const uint8_t* payload, size_t length) {
+  length = min(length, (size_t)MAX_PACKET_PAYLOAD);
+  packet.header.magic = PACKET_MAGIC;
+  packet.header.type = type;
+  packet.header.seq = seq;
+  packet.header.length = length;
+  if (length > 0) {
+    memcpy(packet.payload, payload, length);
+  }
+  return sizeof(PacketHeader) + length;
+}
+
+inline bool validPacket(const CommandPacket& packet, size_t received) {
+  return received >= sizeof(PacketHeader) && packet.header.magic == PACKET_MAGIC &&
+         received >= sizeof(PacketHeader) + packet.header.length && packet.header.length <= MAX_PACKET_PAYLOAD;
+}
+
+// Rover state piggybacked on every poll. Sent as hex in the HTTP
+// "telemetry" query parameter, or raw after the command text in a REQUEST.
+struct __attribute__((packed)) RoverTelemetry {
+  uint16_t executedSeq;    // commands executed since boot
+  uint8_t progress;        // 0-255 through the current maneuver
+  uint8_t mode;            // RoverMode on the rover
+  int16_t poseXCm;         // dead reckoned, x to the right of the start pose
+  int16_t poseYCm;         // dead reckoned, y forward of the start pose
+  int16_t headingDeciDeg;  // positive to the right
+  uint16_t loopMeanUs;
+  uint16_t loopMaxUs;
+  uint16_t freeHeapKb;
+};
+
+inline String encodeHex(const uint8_t* bytes, size_t length) {
+  const char* digits = "0123456789abcdef";
+  String hex;
+  hex.reserve(length * 2);
+  for (size_t i = 0; i < length; i++) {
+    hex += digits[bytes[i] >> 4];
+    hex += digits[bytes[i] & 0x0F];
+  }
+  return hex;
+}
+
+inline bool decodeHex(const String& hex, uint8_t* bytes, size_t length) {
+  if (hex.length() != length * 2) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    char pair[3] = {hex[i * 2], hex[i * 2 + 1], '\0'};
+    char* end;
+    bytes[i] = strtoul(pair, &end, 16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline String encodeTelemetry(const RoverTelemetry& telemetry) {
+  return encodeHex((const uint8_t*)&telemetry, sizeof(RoverTelemetry));
+}
+
+inline bool decodeTelemetry(const String& hex, RoverTelemetry& telemetry) {
+  return decodeHex(hex, (uint8_t*)&telemetry, sizeof(RoverTelemetry));
+}
+
+// Obstacles the camera saw in the frame behind a command, coarse bins as the
+// LLM reports them. Sent as hex in the HTTP "X-Obstacles" header, or raw
+// after the stamp in a COMMAND. Only sent once the LLM's whole reply was
+// parsed: a missing report means unknown, an empty one means nothing seen.
+enum ObstacleSector : uint8_t { SECTOR_LEFT, SECTOR_MIDDLE, SECTOR_RIGHT, SECTOR_COUNT };
+enum ObstacleRange : uint8_t { RANGE_CLOSE, RANGE_MEDIUM, RANGE_FAR, RANGE_COUNT };
+const int MAX_OBSTACLES = 6;
+const uint8_t NO_OBSTACLE_REPORT = 0xFF;   // in a COMMAND's obstacle count
+
+struct ObstacleReport {
+  uint8_t count;
+  uint8_t obstacles[MAX_OBSTACLES];   // sector in the high nibble, range in the low
+};
+
+inline uint8_t packObstacle(ObstacleSector sector, ObstacleRange range) {
+  return (sector << 4) | range;
+}
+
+inline ObstacleSector obstacleSector(uint8_t obstacle) {
+  return (ObstacleSector)(obstacle >> 4);
+}
+
+inline ObstacleRange obstacleRange(uint8_t obstacle) {
+  return (ObstacleRange)(obstacle & 0x0F);
+}
+
+inline bool addObstacle(ObstacleReport& report, ObstacleSector sector, ObstacleRange range) {
+  if (report.count >= MAX_OBSTACLES || sector >= SECTOR_COUNT || range >= RANGE_COUNT) {
+    return false;
+  }
+  report.obstacles[report.count++] = packObstacle(sector, range);
+  return true;
+}
+
+inline String encodeObstacles(const ObstacleReport& report) {
+  return encodeHex(report.obstacles, report.count);
+}
+
+inline bool decodeObstacles(const String& hex, ObstacleReport& report) {
+  size_t count = hex.length() / 2;
+  report.count = 0;
+  if (count > MAX_OBSTACLES || !decodeHex(hex, report.obstacles, count)) {
+    return false;
+  }
+  report.count = count;
+  return true;
+}
+
+// REQUEST payload: [command length][command text][RoverTelemetry]
+inline size_t buildRequestPayload(uint8_t* payload, const String& lastCommand, const RoverTelemetry& telemetry) {
+  size_t commandLength = min((size_t)lastCommand.length(), MAX_PACKET_PAYLOAD - 1 - sizeof(RoverTelemetry));
+  payload[0] = commandLength;
+  memcpy(payload + 1, lastCommand.c_str(), commandLength);
+  memcpy(payload + 1 + commandLength, &telemetry, sizeof(RoverTelemetry));
+  return 1 + commandLength + sizeof(RoverTelemetry);
+}
+
+inline bool parseRequestPayload(const CommandPacket& packet, String& lastCommand, RoverTelemetry& telemetry) {
+  size_t commandLength = packet.header.length > 0 ? packet.payload[0] : 0;
+  if (packet.header.length != 1 + commandLength + sizeof(RoverTelemetry)) {
+    return false;
+  }
+  char text[MAX_PACKET_PAYLOAD];
+  memcpy(text, packet.payload + 1, commandLength);
+  text[commandLength] = '\0';
+  lastCommand = text;
+  memcpy(&telemetry, packet.payload + 1 + commandLength, sizeof(RoverTelemetry));
+  return true;
+}
+
+// COMMAND payload: [CommandStamp][obstacle count][obstacles][command text],
+// with NO_OBSTACLE_REPORT as the count when there is no report. Ages are
+// relative because the two boards don't share a clock. The packet seq is the
+// request's; decisionSeq tells repeated answers from the same decision apart.
+struct __attribute__((packed)) CommandStamp {
+  uint16_t ageMs;         // time since the frame behind this command was captured
+  uint16_t validForMs;    // how long after capture the command may still be executed
+  uint16_t decisionSeq;   // the camera's decision number, 0 before its first
+};
+
+// obstacles is nullptr when there is no report to send
+inline size_t buildCommandPayload(uint8_t* payload, const String& command, const CommandStamp& stamp,
+                                  const ObstacleReport* obstacles) {
+  size_t count = obstacles ? obstacles->count : 0;
+  size_t header = sizeof(CommandStamp) + 1 + count;
+  size_t commandLength = min((size_t)command.length(), MAX_PACKET_PAYLOAD - header);
+  memcpy(payload, &stamp, sizeof(CommandStamp));
+  payload[sizeof(CommandStamp)] = obstacles ? count : NO_OBSTACLE_REPORT;
+  if (count > 0) {
+    memcpy(payload + sizeof(CommandStamp) + 1, obstacles->obstacles, count);
+  }
+  memcpy(payload + header, command.c_str(), commandLength);
+  return header + commandLength;
+}
+
+inline bool parseCommandPayload(const CommandPacket& packet, String& command, CommandStamp& stamp,
+                                bool& hasObstacles, ObstacleReport& obstacles) {
+  if (packet.header.length < sizeof(CommandStamp) + 1) {
+    return false;
+  }
+  hasObstacles = packet.payload[sizeof(CommandStamp)] != NO_OBSTACLE_REPORT;
+  size_t count = hasObstacles ? packet.payload[sizeof(CommandStamp)] : 0;
+  size_t header = sizeof(CommandStamp) + 1 + count;
+  if (count > MAX_OBSTACLES || packet.header.length < header) {
+    return false;
+  }
+  size_t commandLength = packet.header.length - header;
+  char text[MAX_PACKET_PAYLOAD + 1];
+  memcpy(&stamp, packet.payload, sizeof(CommandStamp));
+  obstacles.count = count;
+  memcpy(obstacles.obstacles, packet.payload + sizeof(CommandStamp) + 1, count);
+  memcpy(text, packet.payload + header, commandLength);
+  text[commandLength] = '\0';
+  command = text;
+  return true;
+}
+
+#endif //COMMAND_PACKET_H
@@ -0,0 +1,64 @@
+#include "packetService.h"
+
+PacketLink makePacketLink(const char* name, PacketSender send) {
+  PacketLink link;
+  link.name = name;
+  link.send = send;
+  link.lastServedSeq = 0;
+  link.hasServedCommand = false;
+  link.requests = 0;
+  link.replays = 0;
+  link.deliveredAcks = 0;
+  return link;
+}
+
+void sendLinkPacket(PacketLink& link, PacketType type, uint16_t seq, const uint8_t* payload, size_t length) {
+  CommandPacket packet;
+  length = buildPacket(packet, type, seq, payload, length);
+  link.send((const uint8_t*)&packet, length);
+}
+
+// Re-stamped on every send so a replay carries the decision's current age
+void sendDecision(PacketLink& link, uint16_t seq, const VisionDecision& decision) {
+  uint8_t payload[MAX_PACKET_PAYLOAD];
+  size_t length = buildCommandPayload(payload, decision.command, decisionStamp(decision),
+                                      decision.hasObstacles ? &decision.obstacles : nullptr);
+  sendLinkPacket(link, PACKET_COMMAND, seq, payload, length);
+}
+
+void handleCommandPacket(PacketLink& link, const CommandPacket& packet, size_t length) {
+  if (!validPacket(packet, length)) {
+    return;
+  }
+  uint16_t seq = packet.header.seq;
+
+  if (packet.header.type == PACKET_ACK) {
+    link.deliveredAcks++;
+    return;
+  }
+  if (packet.header.type != PACKET_REQUEST) {
+    return;
+  }
+
+  if (link.hasServedCommand && seq == link.lastServedSeq) {
+    // Our answer or ack got lost, replay it rather than analysing a new frame
+    link.replays++;
+    sendDecision(link, seq, link.lastServedDecision);
+    return;
+  }
+
+  link.requests++;
+  sendLinkPacket(link, PACKET_ACK, seq, nullptr, 0);
+
+  String lastCommand;
+  RoverTelemetry telemetry;
+  bool hasTelemetry = parseRequestPayload(packet, lastCommand, telemetry);
+  updateRoverState(lastCommand, hasTelemetry ? &telemetry : nullptr);
+  VisionDecision decision = serveDecision();
+  link.lastServedSeq = seq;
+  link.lastServedDecision = decision;
+  link.hasServedCommand = true;
+  sendDecision(link, seq, decision);
+  Serial.printf("[%s] Sent command for seq %u (%lu requests, %lu replays, %lu acked)\n", link.name, seq,
+                link.requests, link.replays, link.deliveredAcks);
+}
@@ -0,0 +1,29 @@
+#ifndef PACKET_SERVICE_H
+#define PACKET_SERVICE_H
+
+#include <Arduino.h>
+#include "commandPacket.h"
+#include "visionPipeline.h"
+
+// Sends one encoded CommandPacket back to whoever sent the request
+typedef void (*PacketSender)(const uint8_t* data, size_t length);
+
+// Request/ack/replay state for one packet link (UDP, UART)
+struct PacketLink {
+  const char* name;
+  PacketSender send;
+
+  // Answer to the most recent request, replayed when the rover retries it
+  uint16_t lastServedSeq;
+  VisionDecision lastServedDecision;
+  bool hasServedCommand;
+
+  unsigned long requests;
+  unsigned long replays;
+  unsigned long deliveredAcks;
+};
+
+PacketLink makePacketLink(const char* name, PacketSender send);
+void handleCommandPacket(PacketLink& link, const CommandPacket& packet, size_t length);
+
+#endif //PACKET_SERVICE_H
@@ -0,0 +1,134 @@
+#include "regionOfInterest.h"
+#include "base64Encoder.h"
+
+// OV2640 sensor modes and the full window each one reads out
+const int OV2640_MODE_UXGA = 0;
+const int OV2640_MODE_SVGA = 1;
+const int OV2640_MODE_CIF = 2;
+const int OV2640_FULL_WIDTH = 1600;
+const int OV2640_FULL_HEIGHT = 1200;
+const float MIN_REGION_SIDE = 0.2;
+
+// Set from the web server, read by the capture task
+portMUX_TYPE regionMux = portMUX_INITIALIZER_UNLOCKED;
+RegionOfInterest region = PATH_REGION;
+bool regionDirty = false;
+bool windowingUnsupportedLogged = false;
+
+uint32_t croppedFrames = 0;
+uint64_t totalBytesSaved = 0;
+uint64_t totalUploadMsSaved = 0;
+size_t lastBytesSaved = 0;
+unsigned long lastUploadMsSaved = 0;
+
+bool setRegionOfInterest(const RegionOfInterest& requested) {
+  RegionOfInterest clamped = {constrain(requested.left, 0.0f, 1.0f), constrain(requested.top, 0.0f, 1.0f),
+                              constrain(requested.right, 0.0f, 1.0f), constrain(requested.bottom, 0.0f, 1.0f)};
+  if (clamped.right - clamped.left < MIN_REGION_SIDE || clamped.bottom - clamped.top < MIN_REGION_SIDE) {
+    return false;
+  }
+  portENTER_CRITICAL(&regionMux);
+  region = clamped;
+  regionDirty = true;
+  portEXIT_CRITICAL(&regionMux);
+  return true;
+}
+
+RegionOfInterest regionOfInterest() {
+  portENTER_CRITICAL(&regionMux);
+  RegionOfInterest snapshot = region;
+  portEXIT_CRITICAL(&regionMux);
+  return snapshot;
+}
+
+bool regionChanged() {
+  portENTER_CRITICAL(&regionMux);
+  bool changed = regionDirty;
+  portEXIT_CRITICAL(&regionMux);
+  return changed;
+}
+
+// Multiples of 8 keep the output on whole JPEG blocks
+int alignDown(float value) {
+  return ((int)value) & ~7;
+}
+
+float applyFramesize(sensor_t* sensor, framesize_t framesize) {
+  portENTER_CRITICAL(&regionMux);
+  RegionOfInterest window = region;
+  regionDirty = false;
+  portEXIT_CRITICAL(&regionMux);
+
+  uint16_t width = resolution[framesize].width;
+  uint16_t height = resolution[framesize].height;
+  bool fourByThree = width * 3 == height * 4;
+  bool fullFrame = window.left == 0 && window.top == 0 && window.right == 1 && window.bottom == 1;
+  if (fullFrame || sensor->id.PID != OV2640_PID || !fourByThree) {
+    if (!fullFrame && !windowingUnsupportedLogged) {
+      Serial.println("[ROI] No sensor windowing for this sensor or framesize, uploading full frames");
+      windowingUnsupportedLogged = true;
+    }
+    sensor->set_framesize(sensor, framesize);
+    return 1.0;
+  }
+
+  // Same mode choice as the driver's own set_framesize, so the field of view matches
+  int mode = OV2640_MODE_UXGA;
+  int divider = 1;
+  if (width <= 400 && height <= 296) {
+    mode = OV2640_MODE_CIF;
+    divider = 4;
+  } else if (width <= 800 && height <= 600) {
+    mode = OV2640_MODE_SVGA;
+    divider = 2;
+  }
+  float modeWidth = OV2640_FULL_WIDTH / divider;
+  float modeHeight = OV2640_FULL_HEIGHT / divider;
+  int offsetX = alignDown(window.left * modeWidth);
+  int offsetY = alignDown(window.top * modeHeight);
+  int totalX = alignDown((window.right - window.left) * modeWidth);
+  int totalY = alignDown((window.bottom - window.top) * modeHeight);
+  int outputX = alignDown((window.right - window.left) * width);
+  int outputY = alignDown((window.bottom - window.top) * height);
+
+  sensor->set_res_raw(sensor, mode, 0, 0, 0, offsetX, offsetY, totalX, totalY, outputX, outputY, false, false);
+  Serial.printf("[ROI] Window %dx%d at %d,%d of the sensor, output %dx%d\n", totalX, totalY, offsetX, offsetY,
+                outputX, outputY);
+  return (float)(outputX * outputY) / (width * height);
+}
+
+void recordRegionSavings(size_t jpegBytes, float keptArea, size_t bodyBytes, unsigned long uploadMs) {
+  if (keptArea >= 1.0 || keptArea <= 0) {
+    return;
+  }
+  // JPEG size scales close to linearly with area for the same scene and quality
+  size_t bytesSaved = jpegBytes / keptArea - jpegBytes;
+  // Sent as base64, at the rate this request went up
+  unsigned long uploadMsSaved =
+      uploadMs && bodyBytes ? (uint64_t)base64EncodedLength(bytesSaved) * uploadMs / bodyBytes : 0;
+  // Read by /stats from the loop while the inference task records
+  portENTER_CRITICAL(&regionMux);
+  lastBytesSaved = bytesSaved;
+  lastUploadMsSaved = uploadMsSaved;
+  croppedFrames++;
+  totalBytesSaved += bytesSaved;
+  totalUploadMsSaved += uploadMsSaved;
+  portEXIT_CRITICAL(&regionMux);
+  Serial.printf("[ROI] Sent %.0f%% of the frame, saved ~%u bytes and ~%lu ms upload\n", keptArea * 100,
+                (unsigned)bytesSaved, uploadMsSaved);
+}
+
+String regionStatsText() {
+  RegionOfInterest window = regionOfInterest();
+  portENTER_CRITICAL(&regionMux);
+  uint32_t frames = croppedFrames;
+  uint64_t bytesSaved = totalBytesSaved;
+  uint64_t uploadMsSaved = totalUploadMsSaved;
+  portEXIT_CRITICAL(&regionMux);
+  char text[200];
+  snprintf(text, sizeof(text),
+           "ROI %.2f,%.2f to %.2f,%.2f, %lu cropped frames, saved ~%lu bytes and ~%lu ms upload per frame\n",
+           window.left, window.top, window.right, window.bottom, (unsigned long)frames,
+           (unsigned long)(frames ? bytesSaved / frames : 0), (unsigned long)(frames ? uploadMsSaved / frames : 0));
+  return String(text);
+}
@@ -0,0 +1,37 @@
+#ifndef REGION_OF_INTEREST_H
+#define REGION_OF_INTEREST_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+// Part of the frame uploaded, as fractions of width and height from the top left
+struct RegionOfInterest {
+  float left;
+  float top;
+  float right;
+  float bottom;
+};
+
+// The path in front of the rover: full width, lower 60%, no sky
+const RegionOfInterest PATH_REGION = {0.0, 0.4, 1.0, 1.0};
+const RegionOfInterest FULL_FRAME = {0.0, 0.0, 1.0, 1.0};
+
+// Takes effect from the next capture. Fractions are clamped and a region
+// smaller than a fifth of either side is refused.
+bool setRegionOfInterest(const RegionOfInterest& region);
+RegionOfInterest regionOfInterest();
+// True once the region changed since the sensor was last set up
+bool regionChanged();
+
+// Sets the sensor to framesize, windowed down to the region so the sensor
+// itself outputs only that part. Only the OV2640 supports windowing here;
+// other sensors get the full frame. Returns the fraction of the frame area
+// that is kept.
+float applyFramesize(sensor_t* sensor, framesize_t framesize);
+
+// Per-frame bytes and upload time the crop saved, estimated from the area
+// left out and the measured upload rate
+void recordRegionSavings(size_t jpegBytes, float keptArea, size_t bodyBytes, unsigned long uploadMs);
+String regionStatsText();
+
+#endif //REGION_OF_INTEREST_H
@@ -0,0 +1,85 @@
+#include "requestStream.h"
+
+// Four output characters for the three (or fewer, at the end) input bytes of group
+void encodeGroup(const uint8_t* data, size_t length, size_t group, char* out) {
+  size_t start = group * 3;
+  if (length - start >= 3) {
+    base64EncodeGroups(data + start, 1, out);
+  } else {
+    base64EncodeTail(data + start, length - start, out);
+  }
+}
+
+Base64BodyStream::Base64BodyStream(const String& prefix, const uint8_t* data, size_t length, const String& suffix)
+  : prefix(prefix), data(data), dataLength(length), suffix(suffix), encodedLength((length + 2) / 3 * 4),
+    total(prefix.length() + encodedLength + suffix.length()), lowestFreeHeap(freeHeapBytes()) {}
+
+// Copies body bytes [from, from + length) into out, returns how many there were
+size_t Base64BodyStream::fill(uint8_t* out, size_t length, size_t from) const {
+  size_t written = 0;
+  size_t prefixEnd = prefix.length();
+  size_t dataEnd = prefixEnd + encodedLength;
+
+  while (written < length && from < total) {
+    if (from < prefixEnd) {
+      size_t count = min(length - written, prefixEnd - from);
+      memcpy(out + written, prefix.c_str() + from, count);
+      written += count;
+      from += count;
+    } else if (from < dataEnd) {
+      size_t offset = from - prefixEnd;
+      size_t group = offset / 4;
+      size_t fullGroups = dataLength / 3;
+      size_t groups = 0;
+      if (offset % 4 == 0 && group < fullGroups) {
+        groups = min((length - written) / 4, fullGroups - group);
+      }
+      if (groups > 0) {
+        // Whole groups go straight into the caller's buffer
+        base64EncodeGroups(data + group * 3, groups, (char*)out + written);
+        written += groups * 4;
+        from += groups * 4;
+      } else {
+        // A group split across reads, or the padded last one
+        char chars[4];
+        encodeGroup(data, dataLength, group, chars);
+        size_t within = offset % 4;
+        size_t count = min(length - written, 4 - within);
+        memcpy(out + written, chars + within, count);
+        written += count;
+        from += count;
+      }
+    } else {
+      size_t count = min(length - written, total - from);
+      memcpy(out + written, suffix.c_str() + (from - dataEnd), count);
+      written += count;
+      from += count;
+    }
+  }
+  return written;
+}
+
+int Base64BodyStream::available() {
+  return min(total - position, (size_t)INT32_MAX);
+}
+
+int Base64BodyStream::read() {
+  uint8_t c;
+  return readBytes((char*)&c, 1) ? c : -1;
+}
+
+int Base64BodyStream::peek() {
+  uint8_t c;
+  return fill(&c, 1, position) ? c : -1;
+}
+
+size_t Base64BodyStream::readBytes(char* buffer, size_t length) {
+  if (position == 0) {
+    firstReadMs = millis();
+  }
+  size_t count = fill((uint8_t*)buffer, length, position);
+  lastReadMs = millis();
+  position += count;
+  lowestFreeHeap = min(lowestFreeHeap, freeHeapBytes());
+  return count;
+}
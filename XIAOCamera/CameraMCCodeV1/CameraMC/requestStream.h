@@ -0,0 +1,45 @@
+#ifndef REQUEST_STREAM_H
+#define REQUEST_STREAM_H
+
+#include <Arduino.h>
+#include "utils.h"
+#include "base64Encoder.h"
+
+// Request body of prefix + base64(data) + suffix, generated while HTTPClient
+// reads it. The image is encoded straight into the client's send buffer, so
+// memory use doesn't grow with the image.
+class Base64BodyStream : public Stream {
+public:
+  Base64BodyStream(const String& prefix, const uint8_t* data, size_t length, const String& suffix);
+
+  size_t totalLength() const { return total; }
+  // Lowest free heap seen while the body was being read
+  uint32_t minFreeHeap() const { return lowestFreeHeap; }
+  // First to last read of the body, roughly how long the upload took
+  unsigned long uploadMs() const { return lastReadMs - firstReadMs; }
+  // Starts the body over, for resending it
+  void rewind() { position = 0; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+  void flush() override {}
+
+private:
+  size_t fill(uint8_t* out, size_t length, size_t from) const;
+
+  const String& prefix;
+  const uint8_t* data;
+  size_t dataLength;
+  const String& suffix;
+  size_t encodedLength;
+  size_t total;
+  size_t position = 0;
+  uint32_t lowestFreeHeap;
+  unsigned long firstReadMs = 0;
+  unsigned long lastReadMs = 0;
+};
+
+#endif //REQUEST_STREAM_H
@@ -0,0 +1,334 @@
+#include "responseParser.h"
+#include <ArduinoJson.h>
+#include "utils.h"
+
+const char* const SECTOR_NAMES[SECTOR_COUNT] = {"LEFT", "MIDDLE", "RIGHT"};
+const char* const RANGE_NAMES[RANGE_COUNT] = {"CLOSE", "MEDIUM", "FAR"};
+
+// Index of name in the prompt's bins, or -1
+int binIndex(const char* const* names, int count, const char* name) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(names[i], name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+ResponseParser::ResponseParser(CommandListener onCommand, void* context)
+    : listener(onCommand), listenerContext(context) {
+  result.command[0] = '\0';
+  result.obstacles.count = 0;
+  result.hasCommand = false;
+  result.sawText = false;
+}
+
+size_t ResponseParser::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t ResponseParser::write(const uint8_t* buffer, size_t length) {
+  received += length;
+  if (done()) {
+    return length;
+  }
+  unsigned long start = micros();
+  for (size_t i = 0; i < length && !done(); i++) {
+    feedOuter((char)buffer[i]);
+  }
+  spentUs += micros() - start;
+  return length;
+}
+
+// Just enough of the outer body to find each "text": "..." and unescape it
+void ResponseParser::feedOuter(char c) {
+  if (outer == OUTER_TEXT) {
+    if (unicodeDigits > 0) {
+      unicodeValue = unicodeValue * 16 + (isDigit(c) ? c - '0' : (toupper(c) - 'A' + 10));
+      if (--unicodeDigits == 0) {
+        // Only ASCII matters for the fields we keep
+        feedText(unicodeValue < 0x80 ? (char)unicodeValue : '?');
+      }
+    } else if (outerEscape) {
+      outerEscape = false;
+      if (c == 'u') {
+        unicodeDigits = 4;
+        unicodeValue = 0;
+      } else if (c == 'n' || c == 'r' || c == 't') {
+        feedText(' ');
+      } else {
+        feedText(c);
+      }
+    } else if (c == '\\') {
+      outerEscape = true;
+    } else if (c == '"') {
+      // A streamed reply continues in the next text_delta
+      outer = OUTER_SCAN;
+    } else {
+      feedText(c);
+    }
+    return;
+  }
+
+  if (outerInString) {
+    if (outerEscape) {
+      outerEscape = false;
+    } else if (c == '\\') {
+      outerEscape = true;
+    } else if (c == '"') {
+      outerInString = false;
+      outerKey[outerKeyLength] = '\0';
+      outer = strcmp(outerKey, "text") == 0 ? OUTER_COLON : OUTER_SCAN;
+    } else if (outerKeyLength < sizeof(outerKey) - 1) {
+      outerKey[outerKeyLength++] = c;
+    }
+    return;
+  }
+
+  if (isSpace(c)) {
+    return;
+  }
+  if (outer == OUTER_COLON && c == ':') {
+    outer = OUTER_VALUE;
+  } else if (outer == OUTER_VALUE && c == '"') {
+    outer = OUTER_TEXT;
+    result.sawText = true;
+  } else if (c == '"') {
+    outer = OUTER_KEY;
+    outerInString = true;
+    outerKeyLength = 0;
+  } else {
+    outer = OUTER_SCAN;
+  }
+}
+
+// A finished string inside the text: either a key or a value we might keep
+void ResponseParser::endToken() {
+  token[tokenLength] = '\0';
+  if (expectKey) {
+    strncpy(keys[depth], token, sizeof(keys[depth]) - 1);
+    keys[depth][sizeof(keys[depth]) - 1] = '\0';
+    return;
+  }
+  if (depth == 1 && strcmp(keys[1], "command") == 0 && !result.hasCommand) {
+    strncpy(result.command, token, REPLY_COMMAND_SIZE - 1);
+    result.command[REPLY_COMMAND_SIZE - 1] = '\0';
+    result.hasCommand = true;
+    if (listener) {
+      listener(listenerContext, result);
+    }
+  } else if (depth == 3 && strcmp(keys[1], "obstacles") == 0) {
+    if (strcmp(keys[3], "position") == 0) {
+      obstacleSector = binIndex(SECTOR_NAMES, SECTOR_COUNT, token);
+    } else if (strcmp(keys[3], "distance") == 0) {
+      obstacleRange = binIndex(RANGE_NAMES, RANGE_COUNT, token);
+    }
+  }
+}
+
+void ResponseParser::feedText(char c) {
+  if (quote) {
+    if (escape) {
+      escape = false;
+    } else if (c == '\\') {
+      escape = true;
+      return;
+    } else if (c == quote) {
+      quote = 0;
+      endToken();
+      return;
+    }
+    if (tokenLength < PARSER_TOKEN_SIZE - 1) {
+      token[tokenLength++] = c;
+    }
+    return;
+  }
+
+  // Anything before the first brace, like a sentence or a code fence, is skipped
+  if (depth == 0 && c != '{') {
+    return;
+  }
+  switch (c) {
+    case '{':
+    case '[':
+      if (depth < PARSER_MAX_DEPTH) {
+        depth++;
+        isObject[depth] = c == '{';
+        keys[depth][0] = '\0';
+        expectKey = isObject[depth];
+        if (depth == 3) {
+          obstacleSector = -1;
+          obstacleRange = -1;
+        }
+      } else {
+        // Deeper than anything we keep, counted so the closing brackets still match
+        depth++;
+      }
+      break;
+    case '}':
+    case ']':
+      if (depth == 3 && isObject[3] && strcmp(keys[1], "obstacles") == 0 && obstacleSector >= 0 &&
+          obstacleRange >= 0) {
+        addObstacle(result.obstacles, (ObstacleSector)obstacleSector, (ObstacleRange)obstacleRange);
+      }
+      depth--;
+      expectKey = false;
+      if (depth == 0) {
+        // The reply object is closed, nothing after it is kept
+        outer = OUTER_DONE;
+      }
+      break;
+    case ',':
+      expectKey = depth <= PARSER_MAX_DEPTH && isObject[depth];
+      break;
+    case ':':
+      expectKey = false;
+      break;
+    case '"':
+    case '\'':
+      if (depth <= PARSER_MAX_DEPTH) {
+        quote = c;
+        tokenLength = 0;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Entries with a position or distance outside the prompt's bins are skipped
+void parseObstacles(JsonArrayConst list, ObstacleReport& obstacles) {
+  obstacles.count = 0;
+  for (JsonVariantConst obstacle : list) {
+    int sector = binIndex(SECTOR_NAMES, SECTOR_COUNT, obstacle["position"] | "");
+    int range = binIndex(RANGE_NAMES, RANGE_COUNT, obstacle["distance"] | "");
+    if (sector >= 0 && range >= 0) {
+      addObstacle(obstacles, (ObstacleSector)sector, (ObstacleRange)range);
+    }
+  }
+}
+
+bool parseBufferedResponse(const String& body, VisionReply& reply, uint32_t& heapUsed) {
+  uint32_t heapBefore = freeHeapBytes();
+  reply.hasCommand = false;
+  reply.sawText = false;
+  reply.obstacles.count = 0;
+
+  DynamicJsonDocument responseDoc(8192);
+  DeserializationError error = deserializeJson(responseDoc, body);
+  if (error) {
+    heapUsed = heapBefore - freeHeapBytes();
+    return false;
+  }
+  String responseContent = responseDoc["content"][0]["text"].as<String>();
+  reply.sawText = !responseContent.isEmpty();
+
+  DynamicJsonDocument textDoc(4096);
+  DeserializationError textError = deserializeJson(textDoc, responseContent);
+  // Both documents and the text copy are alive here, the deepest point
+  heapUsed = heapBefore - freeHeapBytes();
+  if (textError || !textDoc.containsKey("command")) {
+    return false;
+  }
+  strncpy(reply.command, textDoc["command"] | "", REPLY_COMMAND_SIZE - 1);
+  reply.command[REPLY_COMMAND_SIZE - 1] = '\0';
+  reply.hasCommand = true;
+  parseObstacles(textDoc["obstacles"].as<JsonArrayConst>(), reply.obstacles);
+  return true;
+}
+
+// Shaped like real replies: one with the prompt's single quotes, one with
+// standard JSON and a code fence around it
+const char* const RECORDED_RESPONSES[] = {
+  "{\"id\":\"msg_01XFDUDYJgAACzvnptvVoYEL\",\"type\":\"message\",\"role\":\"assistant\",\"model\":\"claude-3-opus-20240229\","
+  "\"content\":[{\"type\":\"text\",\"text\":\"{ 'obstacles': [ { 'position': 'LEFT', 'distance': 'CLOSE', "
+  "'description': 'large rock at the path edge' }, { 'position': 'RIGHT', 'distance': 'FAR', 'description': "
+  "'tree trunk' } ], 'command': 'TURN_RIGHT', 'reasoning': 'A rock close on the left blocks the path, the right "
+  "side is clear for several meters.' }\"}],\"stop_reason\":\"end_turn\",\"stop_sequence\":null,"
+  "\"usage\":{\"input_tokens\":1542,\"output_tokens\":96}}",
+  "{\"id\":\"msg_01Bq9w938a90dw8q\",\"type\":\"message\",\"role\":\"assistant\",\"model\":\"claude-3-opus-20240229\","
+  "\"content\":[{\"type\":\"text\",\"text\":\"```json\\n{\\n  \\\"obstacles\\\": [\\n    {\\\"position\\\": "
+  "\\\"MIDDLE\\\", \\\"distance\\\": \\\"MEDIUM\\\", \\\"description\\\": \\\"fallen branch across the "
+  "path\\\"}\\n  ],\\n  \\\"command\\\": \\\"FULL_STOP\\\",\\n  \\\"reasoning\\\": \\\"The branch blocks the "
+  "path ahead and there is no clear way around it.\\\"\\n}\\n```\"}],\"stop_reason\":\"end_turn\","
+  "\"stop_sequence\":null,\"usage\":{\"input_tokens\":1538,\"output_tokens\":88}}",
+};
+
+// A streamed reply in the prompt's order, as text_delta events
+const char* const RECORDED_STREAM =
+  "event: message_start\ndata: {\"type\":\"message_start\",\"message\":{\"id\":\"msg_01Hk2wX9\",\"type\":"
+  "\"message\",\"role\":\"assistant\",\"content\":[],\"model\":\"claude-3-opus-20240229\",\"stop_reason\":null,"
+  "\"usage\":{\"input_tokens\":1540,\"output_tokens\":1}}}\n\n"
+  "event: content_block_start\ndata: {\"type\":\"content_block_start\",\"index\":0,\"content_block\":"
+  "{\"type\":\"text\",\"text\":\"\"}}\n\n"
+  "event: ping\ndata: {\"type\": \"ping\"}\n\n"
+  "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":"
+  "{\"type\":\"text_delta\",\"text\":\"{ 'command': 'TU\"}}\n\n"
+  "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":"
+  "{\"type\":\"text_delta\",\"text\":\"RN_LEFT', 'obstacles': [ { 'position': 'RIGHT', \"}}\n\n"
+  "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":"
+  "{\"type\":\"text_delta\",\"text\":\"'distance': 'CLOSE', 'description': 'stump beside the path' } ], \"}}\n\n"
+  "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":"
+  "{\"type\":\"text_delta\",\"text\":\"'reasoning': 'A stump close on the right, the left side is open.' }\"}}\n\n"
+  "event: content_block_stop\ndata: {\"type\":\"content_block_stop\",\"index\":0}\n\n"
+  "event: message_delta\ndata: {\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"end_turn\","
+  "\"stop_sequence\":null},\"usage\":{\"output_tokens\":52}}\n\n"
+  "event: message_stop\ndata: {\"type\":\"message_stop\"}\n\n";
+
+struct StreamProbe {
+  ResponseParser* parser;
+  size_t commandAt;
+};
+
+void recordCommandOffset(void* context, const VisionReply&) {
+  StreamProbe* probe = (StreamProbe*)context;
+  probe->commandAt = probe->parser->bytesRead();
+}
+
+void benchmarkResponseParsers() {
+  const int RUNS = 20;
+  for (const char* response : RECORDED_RESPONSES) {
+    String body = response;
+    size_t length = body.length();
+
+    VisionReply buffered;
+    uint32_t heapUsed = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < RUNS; i++) {
+      parseBufferedResponse(body, buffered, heapUsed);
+    }
+    unsigned long bufferedUs = (micros() - start) / RUNS;
+
+    // Fed in socket-sized pieces, like writeToStream does
+    unsigned long streamedUs = 0;
+    VisionReply streamed;
+    for (int i = 0; i < RUNS; i++) {
+      ResponseParser parser;
+      for (size_t offset = 0; offset < length; offset += 512) {
+        parser.write((const uint8_t*)body.c_str() + offset, min((size_t)512, length - offset));
+      }
+      streamedUs += parser.parseUs();
+      streamed = parser.reply();
+    }
+    bool matches = buffered.hasCommand == streamed.hasCommand && strcmp(buffered.command, streamed.command) == 0 &&
+                   buffered.obstacles.count == streamed.obstacles.count;
+
+    Serial.printf("[Parser] %u byte response: buffered %lu us, %lu bytes heap + %u byte body; "
+                  "streamed %lu us, %u bytes state, command %s%s\n",
+                  (unsigned)length, bufferedUs, (unsigned long)heapUsed, (unsigned)length, streamedUs / RUNS,
+                  (unsigned)sizeof(ResponseParser), streamed.command, matches ? "" : " MISMATCH");
+  }
+
+  // Fed a byte at a time, the way events trickle in while the reply is generated
+  StreamProbe probe = {nullptr, 0};
+  ResponseParser parser(recordCommandOffset, &probe);
+  probe.parser = &parser;
+  size_t length = strlen(RECORDED_STREAM);
+  for (size_t offset = 0; offset < length; offset++) {
+    parser.write((uint8_t)RECORDED_STREAM[offset]);
+  }
+  const VisionReply& reply = parser.reply();
+  Serial.printf("[Parser] %u byte event stream: command %s after %u bytes, %u obstacles, %lu us\n",
+                (unsigned)length, reply.hasCommand ? reply.command : "missing", (unsigned)probe.commandAt,
+                (unsigned)reply.obstacles.count, parser.parseUs());
+}
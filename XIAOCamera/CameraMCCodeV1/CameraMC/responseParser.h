@@ -0,0 +1,90 @@
+#ifndef RESPONSE_PARSER_H
+#define RESPONSE_PARSER_H
+
+#include <Arduino.h>
+#include "commandPacket.h"
+
+const int REPLY_COMMAND_SIZE = 24;
+const int PARSER_TOKEN_SIZE = 24;
+const int PARSER_MAX_DEPTH = 4;
+
+// The fields of an LLM reply the rover needs
+struct VisionReply {
+  char command[REPLY_COMMAND_SIZE];
+  ObstacleReport obstacles;
+  bool hasCommand;
+  bool sawText;   // the response had a content text block at all
+};
+
+// Called from inside write() the moment the command string is complete,
+// before the rest of the reply has arrived
+typedef void (*CommandListener)(void* context, const VisionReply& reply);
+
+// Parses a Messages API response as it comes off the socket, keeping only
+// the command and obstacles. It unescapes every "text" value in the body and
+// tokenizes the JSON inside them, with single or double quoted strings like
+// the prompt's example. A plain response has one text value; a streamed one
+// has a text_delta event per fragment, and the fragments are fed on as one
+// text. Once the reply object closes, the rest of the body is read but not
+// looked at, so a kept-alive connection stays usable.
+class ResponseParser : public Stream {
+public:
+  ResponseParser(CommandListener onCommand = nullptr, void* context = nullptr);
+
+  const VisionReply& reply() const { return result; }
+  size_t bytesRead() const { return received; }
+  // Time spent inside the parser, excluding waiting on the socket
+  unsigned long parseUs() const { return spentUs; }
+  bool done() const { return outer == OUTER_DONE; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t length) override;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override {}
+
+private:
+  enum OuterState { OUTER_SCAN, OUTER_KEY, OUTER_COLON, OUTER_VALUE, OUTER_TEXT, OUTER_DONE };
+
+  void feedOuter(char c);
+  void feedText(char c);
+  void endToken();
+
+  VisionReply result;
+  CommandListener listener;
+  void* listenerContext;
+  size_t received = 0;
+  unsigned long spentUs = 0;
+
+  // Outer response body
+  OuterState outer = OUTER_SCAN;
+  bool outerInString = false;
+  bool outerEscape = false;
+  int unicodeDigits = 0;
+  uint16_t unicodeValue = 0;
+  char outerKey[8];
+  uint8_t outerKeyLength = 0;
+
+  // JSON inside the text block
+  char quote = 0;
+  bool escape = false;
+  char token[PARSER_TOKEN_SIZE];
+  uint8_t tokenLength = 0;
+  int depth = 0;
+  bool isObject[PARSER_MAX_DEPTH + 1];
+  char keys[PARSER_MAX_DEPTH + 1][12];
+  bool expectKey = false;
+  int obstacleSector = -1;
+  int obstacleRange = -1;
+};
+
+// Parses a whole response body the way it was done before streaming, with
+// two DynamicJsonDocuments, for comparison
+bool parseBufferedResponse(const String& body, VisionReply& reply, uint32_t& heapUsed);
+
+// Times both parsers on recorded responses and logs parse time and memory,
+// then where in a recorded event stream the command became known
+void benchmarkResponseParsers();
+
+#endif //RESPONSE_PARSER_H
@@ -0,0 +1,83 @@
+#include "sceneSignature.h"
+#include "esp_jpg_decode.h"
+
+struct SignatureDecode {
+  const uint8_t* jpeg;
+  uint16_t width;
+  uint16_t height;
+  uint32_t sums[SIGNATURE_ROWS][SIGNATURE_COLUMNS];
+  uint16_t counts[SIGNATURE_ROWS][SIGNATURE_COLUMNS];
+};
+
+size_t readJpeg(void* arg, size_t index, uint8_t* buf, size_t len) {
+  SignatureDecode* decode = (SignatureDecode*)arg;
+  if (buf) {
+    memcpy(buf, decode->jpeg + index, len);
+  }
+  return len;
+}
+
+// Called once with no data and the scaled size before the blocks, and once
+// with no data at the end
+bool writeBlock(void* arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t* data) {
+  SignatureDecode* decode = (SignatureDecode*)arg;
+  if (!data) {
+    if (x == 0 && y == 0) {
+      decode->width = w;
+      decode->height = h;
+    }
+    return true;
+  }
+  if (decode->width == 0 || decode->height == 0) {
+    return false;
+  }
+  for (uint16_t row = 0; row < h; row++) {
+    int cellRow = (y + row) * SIGNATURE_ROWS / decode->height;
+    for (uint16_t column = 0; column < w; column++) {
+      int cellColumn = (x + column) * SIGNATURE_COLUMNS / decode->width;
+      const uint8_t* pixel = data + (row * w + column) * 3;
+      // Green weighted double, the channel order doesn't matter for this
+      decode->sums[cellRow][cellColumn] += (pixel[0] + 2 * pixel[1] + pixel[2]) / 4;
+      decode->counts[cellRow][cellColumn]++;
+    }
+  }
+  return true;
+}
+
+bool computeSceneSignature(const uint8_t* jpeg, size_t length, SceneSignature& signature) {
+  SignatureDecode decode;
+  memset(&decode, 0, sizeof(decode));
+  decode.jpeg = jpeg;
+  signature.valid = esp_jpg_decode(length, JPG_SCALE_8X, readJpeg, writeBlock, &decode) == ESP_OK;
+  if (!signature.valid) {
+    return false;
+  }
+  for (int row = 0; row < SIGNATURE_ROWS; row++) {
+    for (int column = 0; column < SIGNATURE_COLUMNS; column++) {
+      uint16_t count = decode.counts[row][column];
+      signature.luma[row][column] = count ? decode.sums[row][column] / count : 0;
+    }
+  }
+  return true;
+}
+
+int meanLuma(const SceneSignature& signature) {
+  int total = 0;
+  for (int row = 0; row < SIGNATURE_ROWS; row++) {
+    for (int column = 0; column < SIGNATURE_COLUMNS; column++) {
+      total += signature.luma[row][column];
+    }
+  }
+  return total / (SIGNATURE_ROWS * SIGNATURE_COLUMNS);
+}
+
+int sceneDifference(const SceneSignature& a, const SceneSignature& b) {
+  int shift = meanLuma(a) - meanLuma(b);
+  int total = 0;
+  for (int row = 0; row < SIGNATURE_ROWS; row++) {
+    for (int column = 0; column < SIGNATURE_COLUMNS; column++) {
+      total += abs(a.luma[row][column] - b.luma[row][column] - shift);
+    }
+  }
+  return total / (SIGNATURE_ROWS * SIGNATURE_COLUMNS);
+}
@@ -0,0 +1,26 @@
+#ifndef SCENE_SIGNATURE_H
+#define SCENE_SIGNATURE_H
+
+#include <Arduino.h>
+
+const int SIGNATURE_COLUMNS = 16;
+const int SIGNATURE_ROWS = 12;
+// Mean luma change (0-255, brightness shift removed) below which two frames
+// count as the same scene
+const int SCENE_CHANGE_THRESHOLD = 6;
+
+// Coarse luma grid of a frame, built from the JPEG's DC coefficients only
+struct SceneSignature {
+  uint8_t luma[SIGNATURE_ROWS][SIGNATURE_COLUMNS];
+  bool valid;
+};
+
+// Decodes at 1/8 scale, where each 8x8 block is just its DC term, so no
+// inverse DCT runs. Returns false if the JPEG could not be decoded.
+bool computeSceneSignature(const uint8_t* jpeg, size_t length, SceneSignature& signature);
+
+// Mean absolute difference of the two grids after each is shifted to its own
+// mean, so auto exposure alone doesn't read as a change
+int sceneDifference(const SceneSignature& a, const SceneSignature& b);
+
+#endif //SCENE_SIGNATURE_H
@@ -0,0 +1,96 @@
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <Arduino.h>
+#include "commandPacket.h"
+
+// Framing for the wired camera <-> rover link, shared with the camera
+// (XIAOCamera/.../uartFrame.h). Keep both copies identical.
+//   [SOF][length][CommandPacket bytes][CRC16 low][CRC16 high]
+// The CRC (CCITT, 0xFFFF seed) covers the length byte and the packet.
+const uint32_t UART_LINK_BAUD = 921600;
+const uint8_t FRAME_SOF = 0xA5;
+const size_t MAX_FRAME_SIZE = 2 + sizeof(CommandPacket) + 2;
+
+inline uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+inline size_t encodeFrame(const uint8_t* packet, size_t length, uint8_t* frame) {
+  frame[0] = FRAME_SOF;
+  frame[1] = length;
+  memcpy(frame + 2, packet, length);
+  uint16_t crc = crc16(frame + 1, length + 1);
+  frame[2 + length] = crc & 0xFF;
+  frame[3 + length] = crc >> 8;
+  return length + 4;
+}
+
+// Byte at a time decoder, resynchronises on the next SOF after a bad frame
+class FrameDecoder {
+public:
+  // Returns true when a complete packet with a good CRC has been received
+  bool feed(uint8_t byte) {
+    switch (state) {
+      case WAIT_SOF:
+        if (byte == FRAME_SOF) {
+          state = READ_LENGTH;
+        }
+        return false;
+      case READ_LENGTH:
+        if (byte < sizeof(PacketHeader) || byte > sizeof(CommandPacket)) {
+          framingErrors++;
+          state = WAIT_SOF;
+          return false;
+        }
+        expected = byte;
+        received = 0;
+        state = READ_PACKET;
+        return false;
+      case READ_PACKET:
+        buffer[received++] = byte;
+        if (received == expected) {
+          state = READ_CRC_LOW;
+        }
+        return false;
+      case READ_CRC_LOW:
+        crcLow = byte;
+        state = READ_CRC_HIGH;
+        return false;
+      case READ_CRC_HIGH: {
+        state = WAIT_SOF;
+        uint8_t length = expected;
+        uint16_t crc = crc16(buffer, expected, crc16(&length, 1));
+        if (crc != (uint16_t)(crcLow | (byte << 8))) {
+          crcErrors++;
+          return false;
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const CommandPacket& packet() const { return *(const CommandPacket*)buffer; }
+  size_t length() const { return expected; }
+
+  unsigned long crcErrors = 0;
+  unsigned long framingErrors = 0;
+
+private:
+  enum State : uint8_t { WAIT_SOF, READ_LENGTH, READ_PACKET, READ_CRC_LOW, READ_CRC_HIGH };
+
+  State state = WAIT_SOF;
+  uint8_t buffer[sizeof(CommandPacket)];
+  uint8_t expected = 0;
+  uint8_t received = 0;
+  uint8_t crcLow = 0;
+};
+
+#endif //UART_FRAME_H
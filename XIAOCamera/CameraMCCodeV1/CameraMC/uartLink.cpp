@@ -0,0 +1,25 @@
+#include "uartLink.h"
+
+FrameDecoder uartDecoder;
+
+void sendUartPacket(const uint8_t* data, size_t length) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  size_t frameLength = encodeFrame(data, length, frame);
+  Serial1.write(frame, frameLength);
+}
+
+PacketLink uartLink = makePacketLink("UART", sendUartPacket);
+
+void setupUartLink() {
+  Serial1.setRxBufferSize(UART_RX_BUFFER_SIZE);
+  Serial1.begin(UART_LINK_BAUD, SERIAL_8N1, UART_LINK_RX_PIN, UART_LINK_TX_PIN);
+  Serial.printf("[UART] Command link at %lu baud\n", (unsigned long)UART_LINK_BAUD);
+}
+
+void handleUartLink() {
+  while (Serial1.available()) {
+    if (uartDecoder.feed(Serial1.read())) {
+      handleCommandPacket(uartLink, uartDecoder.packet(), uartDecoder.length());
+    }
+  }
+}
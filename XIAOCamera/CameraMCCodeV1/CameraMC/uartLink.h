@@ -0,0 +1,16 @@
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#include <Arduino.h>
+#include "uartFrame.h"
+#include "packetService.h"
+
+// XIAO D6 / D7, wired to the rover's Serial2
+const int UART_LINK_TX_PIN = 43;
+const int UART_LINK_RX_PIN = 44;
+const size_t UART_RX_BUFFER_SIZE = 1024;
+
+void setupUartLink();
+void handleUartLink();
+
+#endif //UART_LINK_H
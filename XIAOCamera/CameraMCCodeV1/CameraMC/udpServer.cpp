@@ -0,0 +1,31 @@
+#include "udpServer.h"
+
+WiFiUDP udpServer;
+
+// Replies go to the sender of the packet currently being handled
+void sendUdpPacket(const uint8_t* data, size_t length) {
+  udpServer.beginPacket(udpServer.remoteIP(), udpServer.remotePort());
+  udpServer.write(data, length);
+  udpServer.endPacket();
+}
+
+PacketLink udpLink = makePacketLink("UDP", sendUdpPacket);
+
+void setupUdpServer() {
+  udpServer.begin(COMMAND_UDP_PORT);
+  Serial.printf("[UDP] Command server listening on port %u\n", COMMAND_UDP_PORT);
+}
+
+void handleUdpServer() {
+  int size = udpServer.parsePacket();
+  if (size <= 0) {
+    return;
+  }
+
+  CommandPacket packet;
+  int received = udpServer.read((unsigned char*)&packet, sizeof(packet));
+  if (received <= 0) {
+    return;
+  }
+  handleCommandPacket(udpLink, packet, received);
+}
@@ -0,0 +1,12 @@
+#ifndef UDP_SERVER_H
+#define UDP_SERVER_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "commandPacket.h"
+#include "packetService.h"
+
+void setupUdpServer();
+void handleUdpServer();
+
+#endif //UDP_SERVER_H
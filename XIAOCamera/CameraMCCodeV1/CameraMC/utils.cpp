@@ -1,5 +1,27 @@
 #include "utils.h"
+#include "base64Encoder.h"
 
 String encodeImageToBase64(const uint8_t* imageData, size_t imageSize) {
-  return base64::encode(imageData, imageSize);
-}
\ No newline at end of file
+  String encoded;
+  if (!encoded.reserve(base64EncodedLength(imageSize))) {
+    return encoded;
+  }
+  // Encoded a piece at a time through a stack buffer, the String is sized once
+  const size_t PIECE_BYTES = 384;
+  char piece[PIECE_BYTES / 3 * 4 + 4];
+  Base64Encoder encoder;
+  for (size_t offset = 0; offset < imageSize; offset += PIECE_BYTES) {
+    size_t length = min(PIECE_BYTES, imageSize - offset);
+    encoded.concat(piece, encoder.update(imageData + offset, length, piece));
+  }
+  encoded.concat(piece, encoder.finish(piece));
+  return encoded;
+}
+
+uint32_t freeHeapBytes() {
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+uint32_t largestFreeBlock() {
+  return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
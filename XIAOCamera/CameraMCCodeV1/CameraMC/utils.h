@@ -3,7 +3,12 @@
 
 #include <Arduino.h>
 #include <Base64.h>
+#include <esp_heap_caps.h>
 
 String encodeImageToBase64(const uint8_t* imageData, size_t imageSize);
 
-#endif //UTILS_H
\ No newline at end of file
+// Free heap across internal RAM and PSRAM, where large Strings end up
+uint32_t freeHeapBytes();
+uint32_t largestFreeBlock();
+
+#endif //UTILS_H
@@ -0,0 +1,396 @@
+#include "visionPipeline.h"
+
+// A JPEG copied out of the camera's buffer, so the driver gets it straight back
+struct FrameSlot {
+  uint8_t* jpeg;
+  size_t length;
+  size_t capacity;
+  unsigned long capturedAtMs;
+  int captureLevel;
+  float keptArea;   // of the full frame, under 1 when cropped to the region of interest
+  VisionRequest request;
+  SceneSignature signature;
+};
+
+FrameSlot frameSlots[FRAME_SLOTS];
+QueueHandle_t freeFrames;
+QueueHandle_t capturedFrames;
+QueueHandle_t preparedFrames;
+
+// Guards the rover state, the latest decision and the stats below. Every
+// task that counts takes it too, /stats reads them all as one snapshot.
+SemaphoreHandle_t pipelineMutex;
+String roverLastCommand = "";
+RoverTelemetry roverTelemetry;
+bool hasRoverTelemetry = false;
+VisionDecision decision;
+// Scene the cached decision was made from, and when the LLM last saw a frame
+SceneSignature decisionSignature;
+unsigned long lastAnalysisMs = 0;
+
+uint32_t framesCaptured = 0;
+uint32_t captureFailures = 0;
+uint32_t capturesSuperseded = 0;
+uint32_t requestsSuperseded = 0;
+uint32_t decisionsMade = 0;
+uint32_t analysesFailed = 0;
+uint32_t framesNotNeeded = 0;
+uint32_t polls = 0;
+uint32_t cacheHits = 0;
+unsigned long lastPollMs = 0;
+uint64_t totalDecisionLatencyMs = 0;
+unsigned long worstDecisionLatencyMs = 0;
+uint32_t gateRuns = 0;
+uint64_t totalGateUs = 0;
+unsigned long worstGateUs = 0;
+uint32_t decisionsReused = 0;
+uint32_t earlyDecisions = 0;
+uint64_t totalCommandMs = 0;
+uint64_t totalReplyMs = 0;
+
+// The frame a request is running for, so its command can be published as
+// soon as it streams in
+struct PendingDecision {
+  unsigned long capturedAtMs;
+  unsigned long requestStartMs;
+  unsigned long commandMs;   // request start to command, 0 until it arrived
+  SceneSignature signature;
+  uint32_t seq;              // of the published decision, 0 until then
+};
+
+// A little headroom, JPEG size moves with the scene
+uint8_t* allocateFrame(size_t length, size_t& capacity) {
+  capacity = length + length / 4;
+  uint8_t* buffer = (uint8_t*)(psramFound() ? ps_malloc(capacity) : malloc(capacity));
+  if (!buffer) {
+    capacity = 0;
+  }
+  return buffer;
+}
+
+void recycleFrame(FrameSlot* slot) {
+  xQueueSend(freeFrames, &slot, 0);
+}
+
+// Queues are one deep and have a single producer, so taking out a waiting
+// frame always leaves room for the new one
+void handOff(QueueHandle_t queue, FrameSlot* slot, uint32_t& superseded) {
+  FrameSlot* waiting;
+  if (xQueueReceive(queue, &waiting, 0) == pdTRUE) {
+    recycleFrame(waiting);
+    xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+    superseded++;
+    xSemaphoreGive(pipelineMutex);
+  }
+  xQueueSend(queue, &slot, 0);
+}
+
+bool captureInto(FrameSlot& slot) {
+  float keptArea;
+  int level = applyCaptureSetting(esp_camera_sensor_get(), keptArea);
+  camera_fb_t* fb = esp_camera_fb_get();
+  unsigned long capturedAtMs = millis();
+  if (!fb) {
+    Serial.println("[Camera] Camera capture failed");
+    xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+    captureFailures++;
+    xSemaphoreGive(pipelineMutex);
+    return false;
+  }
+  if (!recordFrameSize(level, fb->len)) {
+    esp_camera_fb_return(fb);
+    return false;
+  }
+  if (fb->len > slot.capacity) {
+    free(slot.jpeg);
+    slot.jpeg = allocateFrame(fb->len, slot.capacity);
+  }
+  bool copied = slot.jpeg != nullptr;
+  if (copied) {
+    memcpy(slot.jpeg, fb->buf, fb->len);
+    slot.length = fb->len;
+    slot.capturedAtMs = capturedAtMs;
+    slot.captureLevel = level;
+    slot.keptArea = keptArea;
+  } else {
+    Serial.printf("[Camera] No memory for a %u byte frame\n", (unsigned)fb->len);
+  }
+  esp_camera_fb_return(fb);
+  return copied;
+}
+
+void captureTask(void*) {
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CAPTURE_PERIOD_MS));
+    FrameSlot* slot;
+    xQueueReceive(freeFrames, &slot, portMAX_DELAY);
+    if (!captureInto(*slot)) {
+      recycleFrame(slot);
+      continue;
+    }
+    xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+    framesCaptured++;
+    xSemaphoreGive(pipelineMutex);
+    handOff(capturedFrames, slot, capturesSuperseded);
+  }
+}
+
+// Builds the request around the frame with the rover state as it is now
+void encodeTask(void*) {
+  for (;;) {
+    FrameSlot* slot;
+    xQueueReceive(capturedFrames, &slot, portMAX_DELAY);
+
+    xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+    String lastCommand = roverLastCommand;
+    RoverTelemetry telemetry = roverTelemetry;
+    bool hasTelemetry = hasRoverTelemetry;
+    xSemaphoreGive(pipelineMutex);
+
+    unsigned long gateStart = micros();
+    computeSceneSignature(slot->jpeg, slot->length, slot->signature);
+    unsigned long gateUs = micros() - gateStart;
+    xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+    gateRuns++;
+    totalGateUs += gateUs;
+    worstGateUs = max(worstGateUs, gateUs);
+    xSemaphoreGive(pipelineMutex);
+
+    if (!prepareVisionRequest(lastCommand, hasTelemetry ? &telemetry : nullptr, slot->request)) {
+      recycleFrame(slot);
+      continue;
+    }
+    handOff(preparedFrames, slot, requestsSuperseded);
+  }
+}
+
+// Only worth an LLM call while the rover is polling and the cached answer is getting old
+bool inferenceWanted() {
+  unsigned long now = millis();
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  bool wanted = polls > 0 && now - lastPollMs < POLL_DEMAND_MS &&
+                (decision.seq == 0 || now - decision.capturedAtMs >= DECISION_REFRESH_MS);
+  xSemaphoreGive(pipelineMutex);
+  return wanted;
+}
+
+// Nothing the LLM would see differently: the scene matches the one behind the
+// cached decision, and the LLM has looked at the view recently enough
+bool sceneUnchanged(const FrameSlot& slot) {
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  bool unchanged = decision.seq != 0 && decisionSignature.valid && slot.signature.valid &&
+                   millis() - lastAnalysisMs < SCENE_REUSE_LIMIT_MS &&
+                   sceneDifference(slot.signature, decisionSignature) < SCENE_CHANGE_THRESHOLD;
+  if (unchanged) {
+    // Same view, so the decision holds for the newer frame
+    decision.capturedAtMs = slot.capturedAtMs;
+    decisionsReused++;
+  }
+  xSemaphoreGive(pipelineMutex);
+  return unchanged;
+}
+
+// Makes a decision the one the rover is served. obstacles is nullptr unless
+// they came from a fully parsed reply.
+void publishDecision(PendingDecision& pending, const String& command, const ObstacleReport* obstacles) {
+  VisionDecision next;
+  next.command = command;
+  next.capturedAtMs = pending.capturedAtMs;
+  next.validForMs = DECISION_VALIDITY_MS;
+  next.hasObstacles = obstacles != nullptr;
+  next.obstacles.count = 0;
+  if (obstacles) {
+    next.obstacles = *obstacles;
+  }
+  unsigned long latencyMs = millis() - pending.capturedAtMs;
+
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  decisionsMade++;
+  next.seq = decisionsMade;
+  pending.seq = next.seq;
+  decision = next;
+  decisionSignature = pending.signature;
+  lastAnalysisMs = millis();
+  totalDecisionLatencyMs += latencyMs;
+  worstDecisionLatencyMs = max(worstDecisionLatencyMs, latencyMs);
+  xSemaphoreGive(pipelineMutex);
+}
+
+// Called from inside the response read. The command comes before the
+// obstacles, so the decision goes out without a report until the reply is parsed.
+void publishCommand(void* context, const VisionReply& reply) {
+  PendingDecision& pending = *(PendingDecision*)context;
+  pending.commandMs = millis() - pending.requestStartMs;
+  publishDecision(pending, reply.command, nullptr);
+}
+
+// The TLS connection is only touched from here, warming included
+void inferenceTask(void*) {
+  // The first frame shouldn't also pay for the TLS handshake
+  warmClaudeConnection();
+  for (;;) {
+    FrameSlot* slot;
+    if (xQueueReceive(preparedFrames, &slot, pdMS_TO_TICKS(INFERENCE_IDLE_CHECK_MS)) != pdTRUE) {
+      maintainClaudeConnection();
+      continue;
+    }
+    if (!inferenceWanted()) {
+      recycleFrame(slot);
+      xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+      framesNotNeeded++;
+      xSemaphoreGive(pipelineMutex);
+      maintainClaudeConnection();
+      continue;
+    }
+    if (sceneUnchanged(*slot)) {
+      recycleFrame(slot);
+      // Frames keep coming while the scene holds, so the idle check above never runs
+      maintainClaudeConnection();
+      continue;
+    }
+
+    PendingDecision pending;
+    pending.capturedAtMs = slot->capturedAtMs;
+    pending.requestStartMs = millis();
+    pending.commandMs = 0;
+    pending.signature = slot->signature;
+    pending.seq = 0;
+    String command;
+    ObstacleReport obstacles;
+    bool parsed = analyzeImageWithClaude(slot->jpeg, slot->length, slot->request, command, obstacles, publishCommand,
+                                         &pending);
+    unsigned long replyMs = millis() - pending.requestStartMs;
+    recordRequestTime(slot->captureLevel, replyMs);
+    VisionRequestStats requestStats = lastVisionRequestStats();
+    recordRegionSavings(slot->length, slot->keptArea, requestStats.bodyBytes, requestStats.uploadMs);
+    int level = slot->captureLevel;
+    size_t jpegBytes = slot->length;
+    recycleFrame(slot);
+
+    if (pending.seq != 0) {
+      // The command went out already, the parsed reply adds its obstacle report
+      xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+      if (parsed && decision.seq == pending.seq) {
+        decision.obstacles = obstacles;
+        decision.hasObstacles = true;
+      } else if (decision.seq == pending.seq) {
+        // The command stands until it expires, but a failed reply isn't reused for later frames
+        decisionSignature.valid = false;
+      }
+      earlyDecisions++;
+      totalCommandMs += pending.commandMs;
+      totalReplyMs += replyMs;
+      xSemaphoreGive(pipelineMutex);
+      Serial.printf("[Pipeline] Command after %lu ms, full reply after %lu ms\n", pending.commandMs, replyMs);
+      if (!parsed) {
+        Serial.println("[Pipeline] Reply failed after its command: " + command);
+      }
+    } else if (parsed) {
+      publishDecision(pending, command, &obstacles);
+    } else {
+      // An error is no decision: the rover keeps the last one until it expires
+      xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+      analysesFailed++;
+      xSemaphoreGive(pipelineMutex);
+      Serial.printf("[Pipeline] No decision from a frame %lu ms old: %s\n", millis() - pending.capturedAtMs,
+                    command.c_str());
+    }
+    if (parsed) {
+      Serial.printf("[Pipeline] Decision %lu %s from a frame %lu ms old, %s, %u bytes\n",
+                    (unsigned long)pending.seq, command.c_str(), millis() - pending.capturedAtMs,
+                    captureSetting(level).name, (unsigned)jpegBytes);
+    }
+    printPipelineStats();
+  }
+}
+
+void setupVisionPipeline() {
+  pipelineMutex = xSemaphoreCreateMutex();
+  freeFrames = xQueueCreate(FRAME_SLOTS, sizeof(FrameSlot*));
+  capturedFrames = xQueueCreate(1, sizeof(FrameSlot*));
+  preparedFrames = xQueueCreate(1, sizeof(FrameSlot*));
+  for (int i = 0; i < FRAME_SLOTS; i++) {
+    frameSlots[i].jpeg = nullptr;
+    frameSlots[i].length = 0;
+    frameSlots[i].capacity = 0;
+    recycleFrame(&frameSlots[i]);
+  }
+
+  decision.seq = 0;
+  decisionSignature.valid = false;
+  decision.command = "FULL_STOP";
+  decision.capturedAtMs = millis();
+  decision.validForMs = 0;
+  decision.hasObstacles = false;
+  decision.obstacles.count = 0;
+
+  // Inference sits on the network core; capture and encode share the loop's
+  xTaskCreatePinnedToCore(captureTask, "capture", 4096, nullptr, 2, nullptr, 1);
+  xTaskCreatePinnedToCore(encodeTask, "encode", 6144, nullptr, 1, nullptr, 1);
+  xTaskCreatePinnedToCore(inferenceTask, "inference", 16384, nullptr, 1, nullptr, 0);
+  Serial.println("[Pipeline] Vision pipeline started");
+}
+
+void updateRoverState(const String& lastCommand, const RoverTelemetry* telemetry) {
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  roverLastCommand = lastCommand;
+  hasRoverTelemetry = telemetry != nullptr;
+  if (telemetry) {
+    roverTelemetry = *telemetry;
+  }
+  xSemaphoreGive(pipelineMutex);
+}
+
+VisionDecision serveDecision() {
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  unsigned long now = millis();
+  polls++;
+  lastPollMs = now;
+  VisionDecision snapshot = decision;
+  if (snapshot.seq != 0 && now - snapshot.capturedAtMs < snapshot.validForMs) {
+    cacheHits++;
+  }
+  xSemaphoreGive(pipelineMutex);
+  return snapshot;
+}
+
+CommandStamp decisionStamp(const VisionDecision& decision) {
+  CommandStamp stamp;
+  stamp.ageMs = min(millis() - decision.capturedAtMs, 0xFFFFUL);
+  stamp.validForMs = min(decision.validForMs, 0xFFFFUL);
+  stamp.decisionSeq = decision.seq;
+  return stamp;
+}
+
+// Every poll used to be its own LLM call, so calls saved is polls minus calls made
+String pipelineStatsText() {
+  char text[768];
+  xSemaphoreTake(pipelineMutex, portMAX_DELAY);
+  snprintf(text, sizeof(text),
+           "Captured %lu (%lu failed), superseded %lu before encode and %lu before inference\n"
+           "Decisions %lu (%lu analyses failed), capture to decision mean %lu ms, worst %lu ms\n"
+           "Polls %lu, cache hits %lu (%lu%%), LLM calls saved %ld, frames not needed %lu\n"
+           "Scene gate %lu runs, mean %lu us, worst %lu us, decisions reused %lu\n"
+           "Streamed decisions %lu, request to command mean %lu ms, to full reply mean %lu ms\n",
+           (unsigned long)framesCaptured, (unsigned long)captureFailures, (unsigned long)capturesSuperseded,
+           (unsigned long)requestsSuperseded, (unsigned long)decisionsMade, (unsigned long)analysesFailed,
+           (unsigned long)(decisionsMade ? totalDecisionLatencyMs / decisionsMade : 0), worstDecisionLatencyMs,
+           (unsigned long)polls, (unsigned long)cacheHits, (unsigned long)(polls ? cacheHits * 100 / polls : 0),
+           (long)polls - (long)decisionsMade, (unsigned long)framesNotNeeded, (unsigned long)gateRuns,
+           (unsigned long)(gateRuns ? totalGateUs / gateRuns : 0), worstGateUs, (unsigned long)decisionsReused,
+           (unsigned long)earlyDecisions, (unsigned long)(earlyDecisions ? totalCommandMs / earlyDecisions : 0),
+           (unsigned long)(earlyDecisions ? totalReplyMs / earlyDecisions : 0));
+  xSemaphoreGive(pipelineMutex);
+  return String(text);
+}
+
+void printPipelineStats() {
+  String text = pipelineStatsText();
+  int start = 0;
+  int end;
+  while ((end = text.indexOf('\n', start)) >= 0) {
+    Serial.println("[Pipeline] " + text.substring(start, end));
+    start = end + 1;
+  }
+}
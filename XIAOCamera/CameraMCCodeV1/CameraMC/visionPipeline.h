@@ -0,0 +1,54 @@
+#ifndef VISION_PIPELINE_H
+#define VISION_PIPELINE_H
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "claudeAPI.h"
+#include "sceneSignature.h"
+#include "captureController.h"
+#include "regionOfInterest.h"
+#include "commandPacket.h"
+
+// How long after capture a decision may still be executed by the rover
+const unsigned long DECISION_VALIDITY_MS = 3000;
+// Frames are taken this often so the one inference picks up next is never older
+const unsigned long CAPTURE_PERIOD_MS = 250;
+// One frame in each stage plus one waiting, so capture never waits on inference
+const int FRAME_SLOTS = 4;
+// How often an inference task with no frames checks the API connection is still open
+const unsigned long INFERENCE_IDLE_CHECK_MS = 1000;
+// While the rover polls, a cached decision this old is replaced by a new one
+const unsigned long DECISION_REFRESH_MS = 1500;
+// Inference stops once the rover hasn't polled for this long
+const unsigned long POLL_DEMAND_MS = 5000;
+// An unchanged scene reuses the cached decision, but the LLM still looks this often
+const unsigned long SCENE_REUSE_LIMIT_MS = 10000;
+
+struct VisionDecision {
+  uint32_t seq;   // 0 until the first decision is made
+  String command;
+  unsigned long capturedAtMs;
+  unsigned long validForMs;
+  bool hasObstacles;   // obstacles are only sent once the whole reply was parsed
+  ObstacleReport obstacles;
+};
+
+// Starts the capture, encode and inference tasks. They hand frames on through
+// one-deep queues where a newer frame replaces one still waiting, so
+// inference always starts on the freshest frame.
+void setupVisionPipeline();
+
+// Rover state for the prompt of the next frame encoded. telemetry is nullptr
+// if the rover didn't send any.
+void updateRoverState(const String& lastCommand, const RoverTelemetry* telemetry);
+
+// The cached decision for a rover poll, returned without waiting. Counts as a
+// hit while it is inside its validity window. Polls are what keep inference
+// running; until the first decision it is FULL_STOP with no validity.
+VisionDecision serveDecision();
+CommandStamp decisionStamp(const VisionDecision& decision);
+
+String pipelineStatsText();
+void printPipelineStats();
+
+#endif //VISION_PIPELINE_H
@@ -0,0 +1,214 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the camera's logic modules on the
+// host for the native test env. Time only moves when a test (or delay())
+// moves it, unless a test sets hostRealClock to time the modules themselves.
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using std::max;
+using std::min;
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+#define IRAM_ATTR
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg) ((deg) * PI / 180.0)
+#define degrees(rad) ((rad) * 180.0 / PI)
+
+inline uint64_t hostClockUs = 0;
+inline bool hostRealClock = false;
+
+inline uint64_t hostNowUs() {
+  if (hostRealClock) {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+  }
+  return hostClockUs;
+}
+
+inline unsigned long millis() { return hostNowUs() / 1000; }
+inline unsigned long micros() { return hostNowUs(); }
+inline void delayMicroseconds(unsigned int us) {
+  if (hostRealClock) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    hostClockUs += us;
+  }
+}
+inline void delay(unsigned long ms) { delayMicroseconds(ms * 1000); }
+inline void advanceClockMs(unsigned long ms) { hostClockUs += ms * 1000ULL; }
+inline void advanceClockUs(unsigned long us) { hostClockUs += us; }
+
+inline uint32_t hostRandomState = 1;
+inline void randomSeed(unsigned long seed) { hostRandomState = seed ? seed : 1; }
+inline long random(long howBig) {
+  hostRandomState = hostRandomState * 1103515245 + 12345;
+  return howBig > 0 ? (hostRandomState >> 8) % howBig : 0;
+}
+inline long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+
+inline bool isDigit(int c) { return isdigit(c); }
+inline bool isSpace(int c) { return isspace(c); }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+public:
+  String() {}
+  String(const char* text) : value(text ? text : "") {}
+  String(const std::string& text) : value(text) {}
+  String(char c) : value(1, c) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+  String(float number, unsigned int decimals = 2) : value(formatted(number, decimals)) {}
+  String(double number, unsigned int decimals = 2) : value(formatted(number, decimals)) {}
+
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+  bool isEmpty() const { return value.empty(); }
+  bool reserve(unsigned int size) {
+    value.reserve(size);
+    return true;
+  }
+  char operator[](unsigned int index) const { return index < value.size() ? value[index] : 0; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+
+  bool concat(const char* text) {
+    value += text;
+    return true;
+  }
+  bool concat(const char* text, unsigned int length) {
+    value.append(text, length);
+    return true;
+  }
+  String& operator+=(const String& other) {
+    value += other.value;
+    return *this;
+  }
+  String& operator+=(const char* other) {
+    value += other;
+    return *this;
+  }
+  String& operator+=(char other) {
+    value += other;
+    return *this;
+  }
+  friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+  friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.value); }
+  bool operator==(const String& other) const { return value == other.value; }
+  bool operator==(const char* other) const { return value == other; }
+  bool operator!=(const String& other) const { return value != other.value; }
+  bool operator!=(const char* other) const { return value != other; }
+
+  int indexOf(char c, unsigned int from = 0) const { return found(value.find(c, from)); }
+  int indexOf(const String& text, unsigned int from = 0) const { return found(value.find(text.value, from)); }
+  String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < value.size() && to > from ? String(value.substr(from, to - from)) : String();
+  }
+  bool startsWith(const String& prefix) const { return value.rfind(prefix.value, 0) == 0; }
+  void trim() {
+    size_t first = value.find_first_not_of(" \t\r\n");
+    size_t last = value.find_last_not_of(" \t\r\n");
+    value = first == std::string::npos ? "" : value.substr(first, last - first + 1);
+  }
+  long toInt() const { return atol(value.c_str()); }
+  float toFloat() const { return atof(value.c_str()); }
+
+private:
+  static std::string formatted(double number, unsigned int decimals) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, number);
+    return text;
+  }
+  static int found(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+
+  std::string value;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      write(buffer[i]);
+    }
+    return size;
+  }
+  size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+  size_t print(const char* text) { return print(String(text)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int number) { return print(String(number)); }
+  size_t print(unsigned int number) { return print(String(number)); }
+  size_t print(long number) { return print(String(number)); }
+  size_t print(unsigned long number) { return print(String(number)); }
+  size_t print(double number, int decimals = 2) { return print(String(number, decimals)); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + print("\n");
+  }
+  size_t println() { return print("\n"); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return write((const uint8_t*)text, min((size_t)max(length, 0), sizeof(text) - 1));
+  }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    int c;
+    while (count < length && (c = read()) >= 0) {
+      buffer[count++] = c;
+    }
+    return count;
+  }
+};
+
+// Serial prints to stdout so test runs show the modules' own reports
+class HostSerial : public Stream {
+public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+inline HostSerial Serial;
+
+// Critical sections guard against the other core and tasks on the target;
+// the host tests are single threaded
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+#endif //HOST_ARDUINO_H
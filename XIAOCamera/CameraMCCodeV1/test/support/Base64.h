@@ -0,0 +1,32 @@
+#ifndef HOST_BASE64_H
+#define HOST_BASE64_H
+
+// Stand-in for the Base64 library: a plain bit-at-a-time encoder, the
+// reference the word-at-a-time one is checked and timed against on the host
+#include <Arduino.h>
+
+namespace base64 {
+
+inline String encode(const uint8_t* data, size_t length) {
+  const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  encoded.reserve((length + 2) / 3 * 4);
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t bits = data[i] << 16;
+    if (i + 1 < length) {
+      bits |= data[i + 1] << 8;
+    }
+    if (i + 2 < length) {
+      bits |= data[i + 2];
+    }
+    encoded += digits[(bits >> 18) & 0x3F];
+    encoded += digits[(bits >> 12) & 0x3F];
+    encoded += i + 1 < length ? digits[(bits >> 6) & 0x3F] : '=';
+    encoded += i + 2 < length ? digits[bits & 0x3F] : '=';
+  }
+  return String(encoded);
+}
+
+}  // namespace base64
+
+#endif //HOST_BASE64_H
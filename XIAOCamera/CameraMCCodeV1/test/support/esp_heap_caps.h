@@ -0,0 +1,13 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+// The host heap doesn't run out, report a fixed XIAO ESP32S3 sized one
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline size_t heap_caps_get_free_size(uint32_t caps) { return 8 * 1024 * 1024; }
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) { return 4 * 1024 * 1024; }
+
+#endif //HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,58 @@
+#ifndef HOST_ESP_JPG_DECODE_H
+#define HOST_ESP_JPG_DECODE_H
+
+// Stand-in for the camera driver's JPEG decoder. The host has no JPEG
+// encoder to make test frames with, so a "JPEG" here is an already scaled
+// grey image: width and height as little endian uint16, then one luma byte
+// per pixel. It is handed to the writer in blocks like the real decoder's
+// MCUs, as RGB888, after the size-only call, and followed by the end call.
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum { JPG_SCALE_NONE, JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X, JPG_SCALE_MAX = JPG_SCALE_8X } jpg_scale_t;
+typedef size_t (*jpg_reader_cb)(void* arg, size_t index, uint8_t* buf, size_t len);
+typedef bool (*jpg_writer_cb)(void* arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t* data);
+
+const int HOST_JPEG_BLOCK = 4;
+
+inline esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer,
+                                void* arg) {
+  uint8_t header[4];
+  if (len < sizeof(header) || reader(arg, 0, header, sizeof(header)) != sizeof(header)) {
+    return ESP_FAIL;
+  }
+  uint16_t width = header[0] | header[1] << 8;
+  uint16_t height = header[2] | header[3] << 8;
+  if (width == 0 || height == 0 || len != sizeof(header) + (size_t)width * height) {
+    return ESP_FAIL;
+  }
+  if (!writer(arg, 0, 0, width, height, nullptr)) {
+    return ESP_FAIL;
+  }
+
+  uint8_t luma[HOST_JPEG_BLOCK];
+  uint8_t rgb[HOST_JPEG_BLOCK * HOST_JPEG_BLOCK * 3];
+  for (uint16_t y = 0; y < height; y += HOST_JPEG_BLOCK) {
+    for (uint16_t x = 0; x < width; x += HOST_JPEG_BLOCK) {
+      uint16_t w = min<uint16_t>(HOST_JPEG_BLOCK, width - x);
+      uint16_t h = min<uint16_t>(HOST_JPEG_BLOCK, height - y);
+      for (uint16_t row = 0; row < h; row++) {
+        reader(arg, sizeof(header) + (size_t)(y + row) * width + x, luma, w);
+        for (uint16_t column = 0; column < w; column++) {
+          uint8_t* pixel = rgb + (row * w + column) * 3;
+          pixel[0] = pixel[1] = pixel[2] = luma[column];
+        }
+      }
+      if (!writer(arg, x, y, w, h, rgb)) {
+        return ESP_FAIL;
+      }
+    }
+  }
+  writer(arg, 0, 0, 0, 0, nullptr);
+  return ESP_OK;
+}
+
+#endif //HOST_ESP_JPG_DECODE_H
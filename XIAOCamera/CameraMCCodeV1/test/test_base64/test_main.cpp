@@ -0,0 +1,144 @@
+// The word-at-a-time base64 encoder and the streamed request body against a
+// plain reference encoder, at every length and split the upload can produce,
+// then their throughput on a frame sized buffer.
+// Run with: pio test -e native -f test_base64
+#include <unity.h>
+#include <vector>
+#include "base64Encoder.cpp"
+#include "utils.cpp"
+#include "requestStream.cpp"
+
+// A typical VGA JPEG from the camera
+const size_t FRAME_BYTES = 40 * 1024;
+// What HTTPClient asks the body stream for at a time, one TCP segment
+const size_t SEND_CHUNK = 1436;
+
+std::vector<uint8_t> randomBytes(size_t length) {
+  std::vector<uint8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = random(256);
+  }
+  return bytes;
+}
+
+String encodeInPieces(const std::vector<uint8_t>& data, size_t pieceLength) {
+  std::vector<char> out(base64EncodedLength(data.size()) + 4);
+  Base64Encoder encoder;
+  size_t written = 0;
+  for (size_t offset = 0; offset < data.size(); offset += pieceLength) {
+    written += encoder.update(data.data() + offset, min(pieceLength, data.size() - offset), out.data() + written);
+  }
+  written += encoder.finish(out.data() + written);
+  return String(std::string(out.data(), written));
+}
+
+// Reads the whole body through readBytes in chunks of chunkLength
+String readBody(Base64BodyStream& body, size_t chunkLength) {
+  std::string text;
+  std::vector<char> chunk(chunkLength);
+  size_t count;
+  while ((count = body.readBytes(chunk.data(), chunkLength)) > 0) {
+    text.append(chunk.data(), count);
+  }
+  return String(text);
+}
+
+void setUp() {
+  randomSeed(42);
+  hostRealClock = false;
+}
+
+void tearDown() {}
+
+// Every tail length and both paths of base64EncodeGroups (4 groups at a time and single)
+void test_every_length_matches_the_reference() {
+  for (size_t length = 0; length <= 64; length++) {
+    std::vector<uint8_t> data = randomBytes(length);
+    String expected = base64::encode(data.data(), length);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), encodeInPieces(data, max(length, (size_t)1)).c_str());
+  }
+}
+
+// The update() carry of one or two bytes, for every piece size up to a few groups
+void test_pieces_match_one_pass() {
+  std::vector<uint8_t> data = randomBytes(100);
+  String expected = base64::encode(data.data(), data.size());
+  for (size_t piece = 1; piece <= 13; piece++) {
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), encodeInPieces(data, piece).c_str());
+  }
+}
+
+void test_encode_image_matches_the_reference() {
+  std::vector<uint8_t> frame = randomBytes(FRAME_BYTES + 1);
+  String expected = base64::encode(frame.data(), frame.size());
+  String encoded = encodeImageToBase64(frame.data(), frame.size());
+  TEST_ASSERT_EQUAL(expected.length(), encoded.length());
+  TEST_ASSERT_TRUE(expected == encoded);
+}
+
+// Reads of any size, including ones that split groups and straddle the
+// prefix, image and suffix boundaries
+void test_body_stream_matches_the_assembled_body() {
+  String prefix = "{\"source\":{\"data\":\"";
+  String suffix = "\"}}";
+  for (size_t length = 0; length <= 8; length++) {
+    std::vector<uint8_t> image = randomBytes(length * 37 + length);
+    String expected = prefix + base64::encode(image.data(), image.size()) + suffix;
+    for (size_t chunk : {1, 2, 3, 5, 7, 16, 61, 1436}) {
+      Base64BodyStream body(prefix, image.data(), image.size(), suffix);
+      TEST_ASSERT_EQUAL(expected.length(), body.totalLength());
+      TEST_ASSERT_EQUAL((int)expected.length(), body.available());
+      TEST_ASSERT_EQUAL(expected[0], body.peek());
+      TEST_ASSERT_TRUE(expected == readBody(body, chunk));
+      TEST_ASSERT_EQUAL(0, body.available());
+      TEST_ASSERT_EQUAL(-1, body.read());
+    }
+  }
+}
+
+// A retry on a new connection sends the same body again
+void test_body_stream_rewinds() {
+  std::vector<uint8_t> image = randomBytes(1000);
+  String prefix = "[";
+  String suffix = "]";
+  Base64BodyStream body(prefix, image.data(), image.size(), suffix);
+  String first = readBody(body, 700);
+  body.rewind();
+  TEST_ASSERT_TRUE(first == readBody(body, SEND_CHUNK));
+}
+
+// Host numbers only show the relative cost, the board's are in the serial log
+void test_throughput_on_a_frame() {
+  std::vector<uint8_t> frame = randomBytes(FRAME_BYTES);
+  hostRealClock = true;
+  benchmarkBase64(frame.data(), frame.size(), "Host frame");
+
+  const int RUNS = 50;
+  String prefix = "{\"data\":\"";
+  String suffix = "\"}";
+  std::vector<char> chunk(SEND_CHUNK);
+  size_t bytes = 0;
+  unsigned long start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    Base64BodyStream body(prefix, frame.data(), frame.size(), suffix);
+    size_t count;
+    while ((count = body.readBytes(chunk.data(), SEND_CHUNK)) > 0) {
+      bytes += count;
+    }
+  }
+  unsigned long us = max((micros() - start) / RUNS, 1UL);
+  Serial.printf("[Base64] Host body stream: %u byte body in %u byte reads, %lu us (%.1f MB/s)\n",
+                (unsigned)(bytes / RUNS), (unsigned)SEND_CHUNK, us, (float)bytes / RUNS / us);
+  TEST_ASSERT_EQUAL(RUNS * (prefix.length() + base64EncodedLength(FRAME_BYTES) + suffix.length()), bytes);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_length_matches_the_reference);
+  RUN_TEST(test_pieces_match_one_pass);
+  RUN_TEST(test_encode_image_matches_the_reference);
+  RUN_TEST(test_body_stream_matches_the_assembled_body);
+  RUN_TEST(test_body_stream_rewinds);
+  RUN_TEST(test_throughput_on_a_frame);
+  return UNITY_END();
+}
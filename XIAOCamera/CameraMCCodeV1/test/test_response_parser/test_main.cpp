@@ -0,0 +1,157 @@
+// The streaming response parser fed the recorded replies in every way the
+// socket can split them, then timed against the buffered ArduinoJson parse.
+// Run with: pio test -e native -f test_response_parser
+#include <unity.h>
+#include <string>
+#include "utils.cpp"
+#include "base64Encoder.cpp"
+#include "responseParser.cpp"
+
+struct ListenerCalls {
+  int count;
+  VisionReply atCommand;   // the reply as it stood when the command came in
+};
+
+void countCommand(void* context, const VisionReply& reply) {
+  ListenerCalls* calls = (ListenerCalls*)context;
+  calls->count++;
+  calls->atCommand = reply;
+}
+
+// Feeds text in two writes split at splitAt
+VisionReply parseSplit(const std::string& text, size_t splitAt, ListenerCalls* calls = nullptr,
+                       bool* done = nullptr) {
+  ResponseParser parser(calls ? countCommand : nullptr, calls);
+  parser.write((const uint8_t*)text.data(), splitAt);
+  parser.write((const uint8_t*)text.data() + splitAt, text.size() - splitAt);
+  if (done) {
+    *done = parser.done();
+  }
+  return parser.reply();
+}
+
+bool sameReply(const VisionReply& a, const VisionReply& b) {
+  return a.hasCommand == b.hasCommand && strcmp(a.command, b.command) == 0 && a.obstacles.count == b.obstacles.count &&
+         memcmp(a.obstacles.obstacles, b.obstacles.obstacles, a.obstacles.count) == 0;
+}
+
+void setUp() {
+  hostRealClock = false;
+}
+
+void tearDown() {}
+
+void test_recorded_responses_parse() {
+  VisionReply single = parseSplit(RECORDED_RESPONSES[0], 0);
+  TEST_ASSERT_TRUE(single.hasCommand);
+  TEST_ASSERT_EQUAL_STRING("TURN_RIGHT", single.command);
+  TEST_ASSERT_EQUAL(2, single.obstacles.count);
+  TEST_ASSERT_EQUAL(packObstacle(SECTOR_LEFT, RANGE_CLOSE), single.obstacles.obstacles[0]);
+  TEST_ASSERT_EQUAL(packObstacle(SECTOR_RIGHT, RANGE_FAR), single.obstacles.obstacles[1]);
+
+  VisionReply fenced = parseSplit(RECORDED_RESPONSES[1], 0);
+  TEST_ASSERT_EQUAL_STRING("FULL_STOP", fenced.command);
+  TEST_ASSERT_EQUAL(1, fenced.obstacles.count);
+  TEST_ASSERT_EQUAL(packObstacle(SECTOR_MIDDLE, RANGE_MEDIUM), fenced.obstacles.obstacles[0]);
+}
+
+// Every split point of each recorded body: inside keys, escapes, tokens and
+// between the outer and inner JSON
+void test_every_split_gives_the_same_reply() {
+  for (const char* response : RECORDED_RESPONSES) {
+    std::string text = response;
+    VisionReply whole = parseSplit(text, text.size());
+    for (size_t split = 0; split <= text.size(); split++) {
+      TEST_ASSERT_TRUE(sameReply(whole, parseSplit(text, split)));
+    }
+  }
+}
+
+// The command is published from the listener before the obstacles arrive,
+// exactly once however the events are split
+void test_stream_reports_the_command_once_before_the_obstacles() {
+  std::string text = RECORDED_STREAM;
+  for (size_t split = 0; split <= text.size(); split++) {
+    ListenerCalls calls = {0, {}};
+    bool done;
+    VisionReply reply = parseSplit(text, split, &calls, &done);
+    TEST_ASSERT_EQUAL(1, calls.count);
+    TEST_ASSERT_EQUAL_STRING("TURN_LEFT", calls.atCommand.command);
+    TEST_ASSERT_EQUAL(0, calls.atCommand.obstacles.count);
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_EQUAL(1, reply.obstacles.count);
+    TEST_ASSERT_EQUAL(packObstacle(SECTOR_RIGHT, RANGE_CLOSE), reply.obstacles.obstacles[0]);
+  }
+
+  ResponseParser parser;
+  for (char c : text) {
+    parser.write((uint8_t)c);
+  }
+  TEST_ASSERT_TRUE(sameReply(parseSplit(text, 0), parser.reply()));
+}
+
+// JSON escapes of the outer body split between two text_delta events
+void test_escapes_split_across_deltas() {
+  std::string text =
+      "data: {\"delta\":{\"type\":\"text_delta\",\"text\":\"{\\u0027comm\"}}\n\n"
+      "data: {\"delta\":{\"type\":\"text_delta\",\"text\":\"and\\u0027: \\\"FORW\"}}\n\n"
+      "data: {\"delta\":{\"type\":\"text_delta\",\"text\":\"ARD\\\", 'obstacles': [{'position': 'LEFT', \"}}\n\n"
+      "data: {\"delta\":{\"type\":\"text_delta\",\"text\":\"'distance': 'FAR'}]}\"}}\n\n";
+  for (size_t split = 0; split <= text.size(); split++) {
+    bool done;
+    VisionReply reply = parseSplit(text, split, nullptr, &done);
+    TEST_ASSERT_EQUAL_STRING("FORWARD", reply.command);
+    TEST_ASSERT_EQUAL(1, reply.obstacles.count);
+    TEST_ASSERT_TRUE(done);
+  }
+}
+
+// A connection lost mid-reply leaves the command but not a finished reply,
+// which the pipeline must not treat as a full obstacle report
+void test_truncated_reply_is_not_done() {
+  std::string text = RECORDED_STREAM;
+  size_t cut = text.find("'distance'");
+  bool done;
+  VisionReply reply = parseSplit(text.substr(0, cut), cut / 2, nullptr, &done);
+  TEST_ASSERT_TRUE(reply.hasCommand);
+  TEST_ASSERT_FALSE(done);
+  TEST_ASSERT_EQUAL(0, reply.obstacles.count);
+}
+
+void test_reply_without_text_has_no_command() {
+  bool done;
+  VisionReply reply = parseSplit("{\"type\":\"error\",\"error\":{\"message\":\"Overloaded\"}}", 10, nullptr, &done);
+  TEST_ASSERT_FALSE(reply.hasCommand);
+  TEST_ASSERT_FALSE(reply.sawText);
+}
+
+// The on-board benchmark on the host, plus the streamed parser's cost per byte
+void test_parser_benchmark() {
+  hostRealClock = true;
+  benchmarkResponseParsers();
+
+  const int RUNS = 2000;
+  std::string text = RECORDED_STREAM;
+  unsigned long totalUs = 0;
+  for (int i = 0; i < RUNS; i++) {
+    ResponseParser parser;
+    for (size_t offset = 0; offset < text.size(); offset += 64) {
+      parser.write((const uint8_t*)text.data() + offset, min((size_t)64, text.size() - offset));
+    }
+    totalUs += parser.parseUs();
+  }
+  Serial.printf("[Parser] Host: %u byte event stream in 64 byte writes, %.2f us per reply, %.1f ns per byte\n",
+                (unsigned)text.size(), (float)totalUs / RUNS, totalUs * 1000.0f / RUNS / text.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_recorded_responses_parse);
+  RUN_TEST(test_every_split_gives_the_same_reply);
+  RUN_TEST(test_stream_reports_the_command_once_before_the_obstacles);
+  RUN_TEST(test_escapes_split_across_deltas);
+  RUN_TEST(test_truncated_reply_is_not_done);
+  RUN_TEST(test_reply_without_text_has_no_command);
+  RUN_TEST(test_parser_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// Where SCENE_CHANGE_THRESHOLD puts the line between "same view" and "ask
+// the LLM again", on synthetic frames: exposure shifts and sensor noise must
+// stay under it, an obstacle coming into view must not.
+// Run with: pio test -e native -f test_scene_signature
+#include <unity.h>
+#include <vector>
+#include "sceneSignature.cpp"
+
+// A QVGA frame at the decoder's 1/8 scale
+const int FRAME_WIDTH = 40;
+const int FRAME_HEIGHT = 30;
+
+struct Frame {
+  uint8_t luma[FRAME_HEIGHT][FRAME_WIDTH];
+};
+
+// Textured ground under a brighter sky, the same every call
+Frame groundFrame() {
+  Frame frame;
+  for (int y = 0; y < FRAME_HEIGHT; y++) {
+    for (int x = 0; x < FRAME_WIDTH; x++) {
+      int texture = (x * 7 + y * 13) % 11 - 5;
+      frame.luma[y][x] = y < FRAME_HEIGHT / 3 ? 180 + texture : 90 + 2 * texture;
+    }
+  }
+  return frame;
+}
+
+void brighten(Frame& frame, int amount) {
+  for (int y = 0; y < FRAME_HEIGHT; y++) {
+    for (int x = 0; x < FRAME_WIDTH; x++) {
+      frame.luma[y][x] = constrain(frame.luma[y][x] + amount, 0, 255);
+    }
+  }
+}
+
+void addNoise(Frame& frame, int amplitude) {
+  for (int y = 0; y < FRAME_HEIGHT; y++) {
+    for (int x = 0; x < FRAME_WIDTH; x++) {
+      frame.luma[y][x] = constrain(frame.luma[y][x] + random(-amplitude, amplitude + 1), 0, 255);
+    }
+  }
+}
+
+// A dark rock of the given size on the ground, centred on the path
+void addObstacle(Frame& frame, int size) {
+  int left = (FRAME_WIDTH - size) / 2;
+  int top = FRAME_HEIGHT - size - 2;
+  for (int y = top; y < top + size; y++) {
+    for (int x = left; x < left + size; x++) {
+      frame.luma[y][x] = 25;
+    }
+  }
+}
+
+SceneSignature signatureOf(const Frame& frame) {
+  std::vector<uint8_t> jpeg = {FRAME_WIDTH, 0, FRAME_HEIGHT, 0};
+  jpeg.insert(jpeg.end(), &frame.luma[0][0], &frame.luma[0][0] + sizeof(frame.luma));
+  SceneSignature signature;
+  computeSceneSignature(jpeg.data(), jpeg.size(), signature);
+  return signature;
+}
+
+void setUp() {
+  randomSeed(46);
+}
+
+void tearDown() {}
+
+void test_signature_is_the_cell_mean() {
+  Frame frame;
+  for (int y = 0; y < FRAME_HEIGHT; y++) {
+    for (int x = 0; x < FRAME_WIDTH; x++) {
+      frame.luma[y][x] = x < FRAME_WIDTH / 2 ? 40 : 200;
+    }
+  }
+  SceneSignature signature = signatureOf(frame);
+  TEST_ASSERT_TRUE(signature.valid);
+  TEST_ASSERT_EQUAL(40, signature.luma[0][0]);
+  TEST_ASSERT_EQUAL(40, signature.luma[SIGNATURE_ROWS - 1][SIGNATURE_COLUMNS / 2 - 1]);
+  TEST_ASSERT_EQUAL(200, signature.luma[SIGNATURE_ROWS - 1][SIGNATURE_COLUMNS / 2]);
+}
+
+void test_undecodable_frame_gives_no_signature() {
+  const uint8_t truncated[] = {FRAME_WIDTH, 0, FRAME_HEIGHT, 0, 90, 90};
+  SceneSignature signature;
+  TEST_ASSERT_FALSE(computeSceneSignature(truncated, sizeof(truncated), signature));
+  TEST_ASSERT_FALSE(signature.valid);
+}
+
+void test_same_frame_is_unchanged() {
+  SceneSignature a = signatureOf(groundFrame());
+  TEST_ASSERT_EQUAL(0, sceneDifference(a, a));
+}
+
+// Auto exposure moves the whole frame, the mean shift takes it out
+void test_exposure_shift_stays_under_the_threshold() {
+  SceneSignature reference = signatureOf(groundFrame());
+  for (int amount = -40; amount <= 40; amount += 20) {
+    Frame shifted = groundFrame();
+    brighten(shifted, amount);
+    TEST_ASSERT_LESS_THAN(SCENE_CHANGE_THRESHOLD, sceneDifference(signatureOf(shifted), reference));
+  }
+}
+
+// Per-pixel noise averages out over the pixels of a cell
+void test_sensor_noise_stays_under_the_threshold() {
+  SceneSignature reference = signatureOf(groundFrame());
+  for (int i = 0; i < 20; i++) {
+    Frame noisy = groundFrame();
+    addNoise(noisy, 12);
+    TEST_ASSERT_LESS_THAN(SCENE_CHANGE_THRESHOLD, sceneDifference(signatureOf(noisy), reference));
+  }
+}
+
+// Prints the difference against obstacle size, so a threshold change can be
+// judged by the smallest obstacle that still triggers a new LLM call
+void test_obstacle_crosses_the_threshold() {
+  SceneSignature reference = signatureOf(groundFrame());
+  int smallestSeen = 0;
+  Serial.printf("Threshold %d, obstacle size against scene difference:\n", SCENE_CHANGE_THRESHOLD);
+  for (int size = 2; size <= 16; size += 2) {
+    Frame frame = groundFrame();
+    addObstacle(frame, size);
+    int difference = sceneDifference(signatureOf(frame), reference);
+    Serial.printf("  %2dx%-2d px (%4.1f%% of the frame): %d\n", size, size,
+                  100.0 * size * size / (FRAME_WIDTH * FRAME_HEIGHT), difference);
+    if (!smallestSeen && difference >= SCENE_CHANGE_THRESHOLD) {
+      smallestSeen = size;
+    }
+  }
+  // A rock a third of the frame's height, within a rover length or two,
+  // always gets a fresh look; smaller ones wait for SCENE_REUSE_LIMIT_MS
+  TEST_ASSERT_NOT_EQUAL(0, smallestSeen);
+  TEST_ASSERT_LESS_OR_EQUAL(FRAME_HEIGHT / 3, smallestSeen);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_signature_is_the_cell_mean);
+  RUN_TEST(test_undecodable_frame_gives_no_signature);
+  RUN_TEST(test_same_frame_is_unchanged);
+  RUN_TEST(test_exposure_shift_stays_under_the_threshold);
+  RUN_TEST(test_sensor_noise_stays_under_the_threshold);
+  RUN_TEST(test_obstacle_crosses_the_threshold);
+  return UNITY_END();
+}
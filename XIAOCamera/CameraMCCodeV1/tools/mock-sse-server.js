@@ -0,0 +1,94 @@
+// Stands in for the Messages API, replying to every request with a
+// streamed (server-sent events) vision reply at a steady token rate, so the
+// camera's time to command can be compared with its time to full reply.
+//
+//   openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=mock \
+//           -keyout mock-key.pem -out mock-cert.pem
+//   node tools/mock-sse-server.js mock-key.pem mock-cert.pem [--port <n>] [--delay <ms>] [--first <ms>]
+//
+// Then set CLAUDE_API_HOST to this machine's address and CLAUDE_API_PORT to
+// the port in CameraMC/claudeConnection.h. The camera doesn't check the
+// certificate, so a self-signed one is enough.
+const fs = require('fs');
+const https = require('https');
+
+const DEFAULT_PORT = 8443;
+// Roughly what the API takes to start replying to an image, and per fragment after
+const DEFAULT_FIRST_MS = 1500;
+const DEFAULT_DELAY_MS = 60;
+
+const REPLY_FRAGMENTS = [
+        "{ 'command': 'TU", "RN_LEFT', ", "'obstacles': [ { 'position': 'RIGHT', ", "'distance': 'CLOSE', ",
+        "'description': 'stump beside ", "the path' } ], ", "'reasoning': 'A stump close on ", "the right blocks ",
+        "the path, the left ", "side is open for ", "several meters.' }",
+];
+
+const sendEvent = (res, type, data) => {
+        res.write(`event: ${type}\ndata: ${JSON.stringify(Object.assign({type}, data))}\n\n`);
+};
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+const streamReply = async (res, options) => {
+        const start = Date.now();
+        res.writeHead(200, {'Content-Type': 'text/event-stream', 'Cache-Control': 'no-cache'});
+        await sleep(options.first);
+        sendEvent(res, 'message_start', {message: {id: 'msg_mock', type: 'message', role: 'assistant', content: [],
+                model: 'mock', stop_reason: null, usage: {input_tokens: 1540, output_tokens: 1}}});
+        sendEvent(res, 'content_block_start', {index: 0, content_block: {type: 'text', text: ''}});
+        sendEvent(res, 'ping', {});
+
+        let commandMs = 0;
+        let text = '';
+        for (const fragment of REPLY_FRAGMENTS) {
+                await sleep(options.delay);
+                sendEvent(res, 'content_block_delta', {index: 0, delta: {type: 'text_delta', text: fragment}});
+                text += fragment;
+                if (!commandMs && /'command': '[A-Z_]+'/.test(text)) {
+                        commandMs = Date.now() - start;
+                }
+        }
+
+        sendEvent(res, 'content_block_stop', {index: 0});
+        sendEvent(res, 'message_delta', {delta: {stop_reason: 'end_turn', stop_sequence: null},
+                usage: {output_tokens: REPLY_FRAGMENTS.length * 5}});
+        sendEvent(res, 'message_stop', {});
+        res.end();
+        console.log(`command sent after ${commandMs} ms, reply finished after ${Date.now() - start} ms`);
+};
+
+const main = () => {
+        const args = process.argv.slice(2);
+        if (args.length < 2) {
+                console.error('usage: node mock-sse-server.js <key.pem> <cert.pem> [--port <n>] [--delay <ms>] ' +
+                        '[--first <ms>]');
+                process.exit(1);
+        }
+        const option = (name, fallback) => {
+                const index = args.indexOf(name);
+                return index >= 0 ? Number(args[index + 1]) : fallback;
+        };
+        const port = option('--port', DEFAULT_PORT);
+        const options = {delay: option('--delay', DEFAULT_DELAY_MS), first: option('--first', DEFAULT_FIRST_MS)};
+
+        const server = https.createServer({key: fs.readFileSync(args[0]), cert: fs.readFileSync(args[1])},
+                (req, res) => {
+                        let bytes = 0;
+                        req.on('data', (chunk) => {
+                                bytes += chunk.length;
+                        });
+                        req.on('end', () => {
+                                console.log(`${req.method} ${req.url}, ${bytes} byte body`);
+                                if (req.method !== 'POST' || req.url !== '/v1/messages') {
+                                        res.writeHead(404);
+                                        res.end();
+                                        return;
+                                }
+                                streamReply(res, options);
+                        });
+                });
+        server.keepAliveTimeout = 600000;
+        server.listen(port, () => console.log(`mock Messages API on https port ${port}`));
+};
+
+main();